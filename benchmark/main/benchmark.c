@@ -0,0 +1,259 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file benchmark.c
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ds18b20.h"
+#include "benchmark.h"
+
+#ifndef CONFIG_DS18B20_ENABLE_STATS
+#  error "the benchmark requires CONFIG_DS18B20_ENABLE_STATS"
+#endif
+
+#define STATS_BUFFER_SIZE 512            ///< Large enough for the output of ds18b20_stats_format()
+
+static const char * TAG = "benchmark";
+
+/// @cond ignore
+typedef struct
+{
+    OneWireBus * bus;
+    DS18B20_Info * devices[BENCHMARK_MAX_DEVICES];
+    size_t count;
+    unsigned int iterations;
+    unsigned int failures;
+    DS18B20_Stats stats;
+} Benchmark;
+/// @endcond ignore
+
+static int64_t _begin(Benchmark * bench)
+{
+    ds18b20_stats_reset(&bench->stats);
+    return esp_timer_get_time();
+}
+
+static void _report(Benchmark * bench, const char * scenario, size_t count, int64_t start_us)
+{
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    char buffer[STATS_BUFFER_SIZE];
+    int length = ds18b20_stats_format(&bench->stats, buffer, sizeof(buffer));
+    if (length < 0 || length >= (int)sizeof(buffer))
+    {
+        ESP_LOGE(TAG, "%s: stats could not be formatted", scenario);
+        ++bench->failures;
+    }
+    else
+    {
+        printf("{\"scenario\":\"%s\",\"devices\":%d,\"iterations\":%u,\"elapsed_us\":%" PRId64 ",\"stats\":%s}\n",
+               scenario, (int)count, bench->iterations, elapsed_us, buffer);
+    }
+}
+
+static void _check(Benchmark * bench, const char * scenario, DS18B20_ERROR error)
+{
+    if (error != DS18B20_OK)
+    {
+        ESP_LOGW(TAG, "%s: error %d", scenario, error);
+        ++bench->failures;
+    }
+}
+
+static void _set_resolution(Benchmark * bench, DS18B20_RESOLUTION resolution)
+{
+    for (size_t i = 0; i < bench->count; ++i)
+    {
+        if (!ds18b20_set_resolution(bench->devices[i], resolution))
+        {
+            ++bench->failures;
+        }
+    }
+}
+
+static void _convert(Benchmark * bench)
+{
+    // every device has the same resolution, so waiting for the first waits for all
+    ds18b20_convert_all(bench->bus);
+    ds18b20_wait_for_conversion(bench->devices[0]);
+}
+
+static void _bench_init(Benchmark * bench)
+{
+    int64_t start = _begin(bench);
+    for (unsigned int iteration = 0; iteration < bench->iterations; ++iteration)
+    {
+        for (size_t i = 0; i < bench->count; ++i)
+        {
+            if (bench->count == 1)
+            {
+                ds18b20_init_solo(bench->devices[i], bench->bus);
+            }
+            else
+            {
+                ds18b20_init(bench->devices[i], bench->bus, bench->devices[i]->rom_code);
+            }
+        }
+    }
+    _report(bench, "init", bench->count, start);
+}
+
+static void _bench_read(Benchmark * bench, bool use_crc)
+{
+    const char * scenario = use_crc ? "read_crc" : "read_no_crc";
+    for (size_t i = 0; i < bench->count; ++i)
+    {
+        ds18b20_use_crc(bench->devices[i], use_crc);
+    }
+    _convert(bench);
+
+    int64_t start = _begin(bench);
+    for (unsigned int iteration = 0; iteration < bench->iterations; ++iteration)
+    {
+        for (size_t i = 0; i < bench->count; ++i)
+        {
+            float value = 0.0f;
+            _check(bench, scenario, ds18b20_read_temp(bench->devices[i], &value));
+        }
+    }
+    _report(bench, scenario, bench->count, start);
+}
+
+static void _bench_set_resolution(Benchmark * bench)
+{
+    int64_t start = _begin(bench);
+    for (unsigned int iteration = 0; iteration < bench->iterations; ++iteration)
+    {
+        for (int resolution = DS18B20_RESOLUTION_9_BIT; resolution <= DS18B20_RESOLUTION_12_BIT; ++resolution)
+        {
+            _set_resolution(bench, resolution);
+        }
+    }
+    _report(bench, "set_resolution", bench->count, start);
+}
+
+static void _bench_convert_all(Benchmark * bench)
+{
+    for (int resolution = DS18B20_RESOLUTION_9_BIT; resolution <= DS18B20_RESOLUTION_12_BIT; ++resolution)
+    {
+        char scenario[32];
+        snprintf(scenario, sizeof(scenario), "convert_all_%dbit", resolution);
+        _set_resolution(bench, resolution);
+
+        int64_t start = _begin(bench);
+        for (unsigned int iteration = 0; iteration < bench->iterations; ++iteration)
+        {
+            _convert(bench);
+        }
+        _report(bench, scenario, bench->count, start);
+    }
+}
+
+static void _bench_cycle(Benchmark * bench, const char * scenario, size_t count)
+{
+    float values[BENCHMARK_MAX_DEVICES] = {0};
+    DS18B20_ERROR errors[BENCHMARK_MAX_DEVICES] = {0};
+
+    int64_t start = _begin(bench);
+    for (unsigned int iteration = 0; iteration < bench->iterations; ++iteration)
+    {
+        _convert(bench);
+        _check(bench, scenario, ds18b20_read_temp_multi(bench->devices, count, values, errors));
+    }
+    _report(bench, scenario, count, start);
+}
+
+static void _bench_power(Benchmark * bench)
+{
+    bool parasitic = false;
+    if (ds18b20_check_for_parasite_power(bench->bus, &parasitic) != DS18B20_OK)
+    {
+        // assume the worst, as polling for completion would fail
+        ESP_LOGW(TAG, "power supply could not be determined");
+        parasitic = true;
+    }
+
+    for (size_t count = 1; count <= bench->count; ++count)
+    {
+        if (!parasitic)
+        {
+            owb_use_parasitic_power(bench->bus, false);
+            _bench_cycle(bench, "cycle_external", count);
+        }
+        owb_use_parasitic_power(bench->bus, true);
+        _bench_cycle(bench, "cycle_parasitic", count);
+    }
+    owb_use_parasitic_power(bench->bus, parasitic);
+}
+
+int benchmark_run(OneWireBus * bus, unsigned int iterations)
+{
+    Benchmark bench = {
+        .bus = bus,
+        .iterations = iterations,
+    };
+
+    DS18B20_Pool * pool = ds18b20_pool_create(BENCHMARK_MAX_DEVICES);
+    if (pool == NULL)
+    {
+        ESP_LOGE(TAG, "pool could not be allocated");
+        return -1;
+    }
+    bench.count = ds18b20_discover(bus, pool, BENCHMARK_MAX_DEVICES);
+    ESP_LOGI(TAG, "found %zu devices", bench.count);
+    if (bench.count == 0)
+    {
+        ESP_LOGE(TAG, "no devices found");
+        ds18b20_pool_free(&pool);
+        return -1;
+    }
+    for (size_t i = 0; i < bench.count; ++i)
+    {
+        bench.devices[i] = &pool->devices[i];
+    }
+
+    // every device attaches the counters as it is initialised, and bus-wide conversions update them
+    ds18b20_use_default_stats(&bench.stats);
+
+    _bench_init(&bench);
+    _bench_read(&bench, false);
+    _bench_read(&bench, true);
+    _bench_set_resolution(&bench);
+    _bench_convert_all(&bench);
+    _bench_power(&bench);
+
+    ds18b20_use_default_stats(NULL);
+    ds18b20_pool_free(&pool);
+    return bench.failures;
+}
@@ -0,0 +1,67 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file benchmark.h
+ * @brief Benchmark scenarios for the DS18B20 component, independent of the board.
+ *
+ * Each scenario resets a shared set of DS18B20_Stats counters, drives one kind of operation
+ * on every device found on the bus, and prints a single-line JSON object of the form:
+ *
+ *     {"scenario":"read_crc","devices":4,"iterations":10,"elapsed_us":123456,"stats":{...}}
+ *
+ * where "stats" is the output of ds18b20_stats_format(). Requires CONFIG_DS18B20_ENABLE_STATS.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "owb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCHMARK_MAX_DEVICES 8        ///< Maximum number of devices benchmarked on a bus
+
+/**
+ * @brief Run every benchmark scenario against the devices on a bus.
+ *
+ * The scenarios are, in order: device initialisation, temperature reads without and with CRC
+ * checks, resolution programming, broadcast conversion at each resolution, and a complete
+ * convert-and-read cycle of the first 1 to N devices in external and parasitic power modes.
+ * External power mode is skipped if any device is parasitically powered. The bus is returned
+ * to its detected power mode, and each device to 12-bit resolution.
+ *
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] iterations Number of repetitions within each scenario.
+ * @return Number of failed operations, or -1 if no devices were found.
+ */
+int benchmark_run(OneWireBus * bus, unsigned int iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BENCHMARK_H
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file benchmark_main.c
+ * @brief On-target benchmark of the DS18B20 component, on a bus driven by the ESP32 RMT peripheral.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "owb.h"
+#include "owb_rmt.h"
+
+#include "benchmark.h"
+
+static const char * TAG = "benchmark";
+
+void app_main(void)
+{
+    // allow time for the serial monitor to connect before any results are printed
+    vTaskDelay(2000.0 / portTICK_PERIOD_MS);
+
+    owb_rmt_driver_info rmt_driver_info;
+    OneWireBus * owb = owb_rmt_initialize(&rmt_driver_info, CONFIG_BENCHMARK_ONE_WIRE_GPIO, RMT_CHANNEL_1, RMT_CHANNEL_0);
+    owb_use_crc(owb, true);  // enable CRC check for ROM code
+#if CONFIG_BENCHMARK_STRONG_PULLUP_GPIO >= 0
+    owb_use_strong_pullup_gpio(owb, CONFIG_BENCHMARK_STRONG_PULLUP_GPIO);
+#endif
+
+    int failures = benchmark_run(owb, CONFIG_BENCHMARK_ITERATIONS);
+    if (failures != 0)
+    {
+        ESP_LOGE(TAG, "benchmark complete, %d failures", failures);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "benchmark complete");
+    }
+
+    owb_uninitialize(owb);
+}
@@ -28,28 +28,35 @@
  * Resolution is cached in the DS18B20_Info object to avoid querying the hardware
  * every time a temperature conversion is required. However this can result in the
  * cached value becoming inconsistent with the hardware value, so care must be taken.
+ * The alarm trigger and configuration registers are cached in the same way, so that
+ * configuration changes can avoid reading the scratchpad, or writing unchanged values.
  *
  */
 
+#include <stdio.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <math.h>
+#include <inttypes.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"      // for esp_timer_get_time()
 #include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_sys.h"      // for esp_rom_delay_us()
 #include "esp_log.h"
 
 #include "ds18b20.h"
 #include "owb.h"
 
 static const char * TAG = "ds18b20";
-static const int T_CONV = 750;   // maximum conversion time at 12-bit resolution in milliseconds
+static const int T_EEPROM = 10;  // maximum EEPROM write time in milliseconds
+static const int T_RECALL_SLOTS = 100;  // maximum read slots to wait for an EEPROM recall, about 7 ms
 
 // Function commands
 #define DS18B20_FUNCTION_TEMP_CONVERT       0x44  ///< Initiate a single temperature conversion
@@ -59,6 +66,9 @@ static const int T_CONV = 750;   // maximum conversion time at 12-bit resolution
 #define DS18B20_FUNCTION_EEPROM_RECALL      0xB8  ///< Restore alarm trigger values and configuration data from EEPROM to the scratchpad
 #define DS18B20_FUNCTION_POWER_SUPPLY_READ  0xB4  ///< Determine if a device is using parasitic power
 
+// ROM commands
+#define DS18B20_ROM_SEARCH_ALARM            0xEC  ///< Search for devices with their alarm flag set
+
 /// @cond ignore
 typedef struct
 {
@@ -69,17 +79,68 @@ typedef struct
     uint8_t reserved[3];
     uint8_t crc;
 } __attribute__((packed)) Scratchpad;
+
+typedef struct
+{
+    OneWireBus_ROMCode rom_code;
+    int last_discrepancy;
+    bool last_device;
+} AlarmSearchState;
 /// @endcond ignore
 
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+#  define STATS_INC(info, field) do { if ((info)->stats) { ++(info)->stats->field; } } while (0)
+#  define STATS_TIME() esp_timer_get_time()
+
+// Counters attached to every instance as it is initialised, and updated by bus-wide operations
+static DS18B20_Stats * _default_stats = NULL;
+#else
+#  define STATS_INC(info, field) do { } while (0)
+#  define STATS_TIME() 0
+#endif
+
+// Debug logging and handle validation on the temperature read path can be compiled out entirely
+#ifdef CONFIG_DS18B20_STRIP_HOT_PATH_LOGS
+#  define HOT_LOGD(tag, ...) do { } while (0)
+#  define HOT_LOG_BUFFER_HEX(tag, buffer, len) do { } while (0)
+#  define HOT_IS_INIT(info) (true)
+#else
+#  define HOT_LOGD(tag, ...) ESP_LOGD(tag, __VA_ARGS__)
+#  define HOT_LOG_BUFFER_HEX(tag, buffer, len) ESP_LOG_BUFFER_HEX_LEVEL(tag, buffer, len, ESP_LOG_DEBUG)
+#  define HOT_IS_INIT(info) _is_init(info)
+#endif
+
 static void _init(DS18B20_Info * ds18b20_info, const OneWireBus * bus)
 {
     if (ds18b20_info != NULL)
     {
         ds18b20_info->bus = bus;
+        ds18b20_info->bus_lock = NULL;
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+        ds18b20_info->stats = _default_stats;
+#endif
         memset(&ds18b20_info->rom_code, 0, sizeof(ds18b20_info->rom_code));
         ds18b20_info->use_crc = false;
         ds18b20_info->resolution = DS18B20_RESOLUTION_INVALID;
         ds18b20_info->solo = false;   // assume multiple devices unless told otherwise
+        ds18b20_info->use_calibration = false;
+        ds18b20_info->calibrated_conversion_us = 0;
+        ds18b20_info->config_valid = false;
+        ds18b20_info->config_unverified = false;
+        ds18b20_info->use_plausibility_check = false;
+        ds18b20_info->last_valid = false;
+        ds18b20_info->use_low_power_wait = false;
+        ds18b20_info->use_power_on_recovery = false;
+        ds18b20_info->last_raw = 0;
+        ds18b20_info->max_step = 0;
+        ds18b20_info->crc_interval = 0;
+        ds18b20_info->crc_count = 0;
+        ds18b20_info->crc_retries = 0;
+        ds18b20_info->presence_retries = 0;
+        ds18b20_info->retry_backoff_us = 0;
+        ds18b20_info->trigger_high = 0;
+        ds18b20_info->trigger_low = 0;
+        ds18b20_info->configuration = 0;
         ds18b20_info->init = true;
     }
     else
@@ -110,29 +171,129 @@ static bool _is_init(const DS18B20_Info * ds18b20_info)
     return ok;
 }
 
-static bool _address_device(const DS18B20_Info * ds18b20_info)
+static void _take_lock(SemaphoreHandle_t bus_lock)
+{
+    if (bus_lock != NULL)
+    {
+        xSemaphoreTakeRecursive(bus_lock, portMAX_DELAY);
+    }
+}
+
+static void _give_lock(SemaphoreHandle_t bus_lock)
+{
+    if (bus_lock != NULL)
+    {
+        xSemaphoreGiveRecursive(bus_lock);
+    }
+}
+
+static void _lock_bus(const DS18B20_Info * ds18b20_info)
+{
+    _take_lock(ds18b20_info->bus_lock);
+}
+
+static void _unlock_bus(const DS18B20_Info * ds18b20_info)
+{
+    _give_lock(ds18b20_info->bus_lock);
+}
+
+static bool _may_convert(const OneWireBus * bus, SemaphoreHandle_t bus_lock)
+{
+    // Parasitically powered devices need the bus to themselves until the conversion is complete,
+    // which only the caller can guarantee, as the lock cannot be held across the caller's wait.
+    if (bus->use_parasitic_power && bus_lock != NULL && xSemaphoreGetMutexHolder(bus_lock) != xTaskGetCurrentTaskHandle())
+    {
+        ESP_LOGE(TAG, "parasitic conversion on a shared bus requires the bus lock to be held");
+        return false;
+    }
+    return true;
+}
+
+static bool _can_poll(const DS18B20_Info * ds18b20_info)
+{
+    // Devices signal completion in response to read slots only until the next reset,
+    // so polling is unreliable if another task may use the bus during the conversion.
+    return !ds18b20_info->bus->use_parasitic_power && ds18b20_info->bus_lock == NULL
+        && !ds18b20_info->use_low_power_wait;
+}
+
+static void _release_pullup(const OneWireBus * bus)
+{
+    // End the strong pullup window opened by a Convert T command, so that the bus can be used.
+    if (bus->use_parasitic_power)
+    {
+        owb_set_strong_pullup(bus, false);
+    }
+}
+
+static bool _select_device(const DS18B20_Info * ds18b20_info)
 {
     bool present = false;
-    if (_is_init(ds18b20_info))
+    owb_reset(ds18b20_info->bus, &present);
+    STATS_INC(ds18b20_info, resets);
+    if (!present)
+    {
+        STATS_INC(ds18b20_info, not_present);
+    }
+    else
     {
-        owb_reset(ds18b20_info->bus, &present);
-        if (present)
+        if (ds18b20_info->solo)
         {
-            if (ds18b20_info->solo)
-            {
-                // if there's only one device on the bus, we can skip
-                // sending the ROM code and instruct it directly
-                owb_write_byte(ds18b20_info->bus, OWB_ROM_SKIP);
-            }
-            else
-            {
-                // if there are multiple devices on the bus, a Match ROM command
-                // must be issued to address a specific slave
-                owb_write_byte(ds18b20_info->bus, OWB_ROM_MATCH);
-                owb_write_rom_code(ds18b20_info->bus, ds18b20_info->rom_code);
-            }
+            // if there's only one device on the bus, we can skip
+            // sending the ROM code and instruct it directly
+            owb_write_byte(ds18b20_info->bus, OWB_ROM_SKIP);
+        }
+        else
+        {
+            // if there are multiple devices on the bus, a Match ROM command
+            // must be issued to address a specific slave
+            owb_write_byte(ds18b20_info->bus, OWB_ROM_MATCH);
+            owb_write_rom_code(ds18b20_info->bus, ds18b20_info->rom_code);
+        }
+    }
+    return present;
+}
+
+static DS18B20_ERROR _select_device_command(const DS18B20_Info * ds18b20_info, uint8_t command)
+{
+    // Equivalent to _select_device() followed by writing the command, but sends the ROM
+    // command, ROM code and function command as a single transfer, which leaves the bus driver
+    // no gaps between phases and costs one call rather than three.
+    DS18B20_ERROR err = DS18B20_ERROR_DEVICE;
+    bool present = false;
+    owb_reset(ds18b20_info->bus, &present);
+    STATS_INC(ds18b20_info, resets);
+    if (!present)
+    {
+        STATS_INC(ds18b20_info, not_present);
+    }
+    else
+    {
+        uint8_t buffer[1 + sizeof(ds18b20_info->rom_code.bytes) + 1];
+        size_t length = 0;
+        if (ds18b20_info->solo)
+        {
+            buffer[length++] = OWB_ROM_SKIP;
         }
         else
+        {
+            buffer[length++] = OWB_ROM_MATCH;
+            memcpy(&buffer[length], ds18b20_info->rom_code.bytes, sizeof(ds18b20_info->rom_code.bytes));
+            length += sizeof(ds18b20_info->rom_code.bytes);
+        }
+        buffer[length++] = command;
+        err = (owb_write_bytes(ds18b20_info->bus, buffer, length) == OWB_STATUS_OK) ? DS18B20_OK : DS18B20_ERROR_OWB;
+    }
+    return err;
+}
+
+static bool _address_device(const DS18B20_Info * ds18b20_info)
+{
+    bool present = false;
+    if (_is_init(ds18b20_info))
+    {
+        present = _select_device(ds18b20_info);
+        if (!present)
         {
             ESP_LOGE(TAG, "ds18b20 device not responding");
         }
@@ -145,35 +306,132 @@ static bool _check_resolution(DS18B20_RESOLUTION resolution)
     return (resolution >= DS18B20_RESOLUTION_9_BIT) && (resolution <= DS18B20_RESOLUTION_12_BIT);
 }
 
-static float _wait_for_duration(DS18B20_RESOLUTION resolution)
+#define TIMING(resolution) {                                                 \
+        .conversion_us = DS18B20_CONVERSION_TIME_US(resolution),                  \
+        .timeout_us = DS18B20_CONVERSION_TIMEOUT_US(resolution),                  \
+        .conversion_ticks = DS18B20_US_TO_TICKS(DS18B20_CONVERSION_TIME_US(resolution)), \
+        .timeout_ticks = DS18B20_US_TO_TICKS(DS18B20_CONVERSION_TIMEOUT_US(resolution)), \
+    }
+
+// indexed by resolution - DS18B20_RESOLUTION_9_BIT
+static const DS18B20_Timing TIMINGS[] = { TIMING(9), TIMING(10), TIMING(11), TIMING(12) };
+
+static const DS18B20_Timing * _timing(DS18B20_RESOLUTION resolution)
 {
-    int64_t start_time = esp_timer_get_time();
-    if (_check_resolution(resolution))
+    // assume worst case if resolution is unknown
+    if (!_check_resolution(resolution))
+    {
+        resolution = DS18B20_RESOLUTION_12_BIT;
+    }
+    return &TIMINGS[resolution - DS18B20_RESOLUTION_9_BIT];
+}
+
+static int64_t _conversion_time_us(DS18B20_RESOLUTION resolution)
+{
+    return _timing(resolution)->conversion_us;
+}
+
+static void _stats_conversion(const DS18B20_Info * ds18b20_info, int64_t elapsed_us, bool timed_out)
+{
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+    DS18B20_Stats * stats = ds18b20_info->stats;
+    if (stats)
     {
-        int divisor = 1 << (DS18B20_RESOLUTION_12_BIT - resolution);
-        ESP_LOGD(TAG, "divisor %d", divisor);
-        float max_conversion_time = (float)T_CONV / (float)divisor;
-        int ticks = ceil(max_conversion_time / portTICK_PERIOD_MS);
-        ESP_LOGD(TAG, "wait for conversion: %.3f ms, %d ticks", max_conversion_time, ticks);
+        int64_t bucket = elapsed_us * 8 / _conversion_time_us(ds18b20_info->resolution);
+        if (bucket >= DS18B20_STATS_HISTOGRAM_BUCKETS)
+        {
+            bucket = DS18B20_STATS_HISTOGRAM_BUCKETS - 1;
+        }
+        ++stats->conversions;
+        ++stats->conversion_histogram[bucket];
+        if (timed_out)
+        {
+            ++stats->conversion_timeouts;
+        }
+    }
+#endif
+}
 
-        // wait at least this maximum conversion time
-        vTaskDelay(ticks);
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+static void _stats_add_bus_time(DS18B20_Stats * stats, DS18B20_BUS_OP op, int64_t start_time)
+{
+    if (stats)
+    {
+        DS18B20_BusTime * bus_time = &stats->bus_time[op];
+        uint32_t duration = (uint32_t)(esp_timer_get_time() - start_time);
+        ++bus_time->count;
+        bus_time->total_us += duration;
+        if (duration > bus_time->max_us)
+        {
+            bus_time->max_us = duration;
+        }
     }
-    int64_t end_time = esp_timer_get_time();
-    return (float)(end_time - start_time) / 1000000.0f;
 }
+#endif
 
-static float _wait_for_device_signal(const DS18B20_Info * ds18b20_info)
+static void _stats_bus_time(const DS18B20_Info * ds18b20_info, DS18B20_BUS_OP op, int64_t start_time)
 {
-    float elapsed_time = 0.0f;
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+    _stats_add_bus_time(ds18b20_info->stats, op, start_time);
+#endif
+}
+
+static void _stats_broadcast_convert(bool is_present, int64_t start_time)
+{
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+    // not addressed to any one device, so accounted to the default counters
+    DS18B20_Stats * stats = _default_stats;
+    if (stats)
+    {
+        ++stats->resets;
+        if (!is_present)
+        {
+            ++stats->not_present;
+        }
+        _stats_add_bus_time(stats, DS18B20_BUS_OP_CONVERT, start_time);
+    }
+#endif
+}
+
+static int64_t _device_conversion_time_us(const DS18B20_Info * ds18b20_info)
+{
+    int64_t conversion_time = _conversion_time_us(ds18b20_info->resolution);
+    if (ds18b20_info->use_calibration && ds18b20_info->calibrated_conversion_us > 0
+        && _check_resolution(ds18b20_info->resolution))
+    {
+        // scale the learned 12-bit value to the current resolution, add the guard band,
+        // and never exceed the datasheet maximum
+        int64_t calibrated = (int64_t)ds18b20_info->calibrated_conversion_us >> (DS18B20_RESOLUTION_12_BIT - ds18b20_info->resolution);
+        calibrated += calibrated * DS18B20_CALIBRATION_GUARD_PERCENT / 100;
+        if (calibrated < conversion_time)
+        {
+            conversion_time = calibrated;
+        }
+    }
+    return conversion_time;
+}
+
+static uint32_t _wait_for_duration(const DS18B20_Info * ds18b20_info)
+{
+    int64_t start_time = esp_timer_get_time();
     if (_check_resolution(ds18b20_info->resolution))
     {
-        int divisor = 1 << (DS18B20_RESOLUTION_12_BIT - ds18b20_info->resolution);
+        // wait at least the maximum conversion time, which is precomputed unless calibrated
+        const DS18B20_Timing * timing = _timing(ds18b20_info->resolution);
+        int64_t conversion_time = _device_conversion_time_us(ds18b20_info);
+        vTaskDelay(conversion_time == timing->conversion_us ? timing->conversion_ticks : DS18B20_US_TO_TICKS(conversion_time));
+    }
+    int64_t end_time = esp_timer_get_time();
+    return (uint32_t)((end_time - start_time) / 1000);
+}
 
-        // allow for 10% overtime
-        float max_conversion_time = (float)T_CONV / (float)divisor * 1.1;
-        int max_conversion_ticks = ceil(max_conversion_time / portTICK_PERIOD_MS);
-        ESP_LOGD(TAG, "wait for conversion: max %.0f ms, %d ticks", max_conversion_time, max_conversion_ticks);
+static uint32_t _wait_for_device_signal(const DS18B20_Info * ds18b20_info)
+{
+    uint32_t elapsed_time = 0;
+    if (_check_resolution(ds18b20_info->resolution))
+    {
+        // allow for DS18B20_CONVERSION_OVERTIME_PERCENT beyond the datasheet maximum
+        TickType_t max_conversion_ticks = _timing(ds18b20_info->resolution)->timeout_ticks;
 
         // wait for conversion to complete - all devices will pull bus low once complete
         TickType_t start_ticks = xTaskGetTickCount();
@@ -187,377 +445,2047 @@ static float _wait_for_device_signal(const DS18B20_Info * ds18b20_info)
         } while (status == 0 && duration_ticks < max_conversion_ticks);
 
         elapsed_time = duration_ticks * portTICK_PERIOD_MS;
+        _stats_conversion(ds18b20_info, (int64_t)duration_ticks * portTICK_PERIOD_MS * 1000, duration_ticks >= max_conversion_ticks);
         if (duration_ticks >= max_conversion_ticks)
         {
             ESP_LOGW(TAG, "conversion timed out");
         }
         else
         {
-            ESP_LOGD(TAG, "conversion took at most %.0f ms", elapsed_time);
+            ESP_LOGD(TAG, "conversion took at most %" PRIu32 " ms", elapsed_time);
         }
     }
     return elapsed_time;
 }
 
-static float _decode_temp(uint8_t lsb, uint8_t msb, DS18B20_RESOLUTION resolution)
+/// @cond ignore
+typedef struct PreciseWait
 {
-    float result = 0.0f;
-    if (_check_resolution(resolution))
+    struct PreciseWait * next;   // next idle context
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t signal;
+    const OneWireBus * bus;
+    int64_t timeout;
+    int64_t end_time;
+    bool poll;
+    volatile bool done;
+    volatile bool complete;
+} PreciseWait;
+/// @endcond ignore
+
+// Wait contexts, each with its own timer and semaphore, are reused rather than created for
+// every conversion. Only as many are ever allocated as there have been concurrent waits.
+static PreciseWait * _idle_waits = NULL;
+static portMUX_TYPE _idle_waits_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void _precise_wait_callback(void * arg)
+{
+    PreciseWait * wait = (PreciseWait *)arg;
+    if (!wait->done)
     {
-        // masks to remove undefined bits from result
-        static const uint8_t lsb_mask[4] = { ~0x07, ~0x03, ~0x01, ~0x00 };
-        uint8_t lsb_masked = lsb_mask[resolution - DS18B20_RESOLUTION_9_BIT] & lsb;
-        int16_t raw = (msb << 8) | lsb_masked;
-        result = raw / 16.0f;
+        uint8_t status = 0;
+        if (wait->poll)
+        {
+            // all devices hold the bus low until their conversion is complete
+            owb_read_bit(wait->bus, &status);
+        }
+        int64_t now = esp_timer_get_time();
+        if (status || now >= wait->timeout)
+        {
+            // A periodic timer is stopped here, so that the context is idle once signalled.
+            // The waiting task may reuse it as soon as the semaphore is given.
+            if (wait->poll)
+            {
+                esp_timer_stop(wait->timer);
+            }
+            else
+            {
+                _release_pullup(wait->bus);
+            }
+            wait->end_time = now;
+            wait->complete = (status != 0) || !wait->poll;
+            wait->done = true;
+            xSemaphoreGive(wait->signal);
+        }
     }
-    else
+}
+
+static PreciseWait * _acquire_wait(void)
+{
+    portENTER_CRITICAL(&_idle_waits_lock);
+    PreciseWait * wait = _idle_waits;
+    if (wait)
     {
-        ESP_LOGE(TAG, "Unsupported resolution %d", resolution);
+        _idle_waits = wait->next;
     }
-    return result;
+    portEXIT_CRITICAL(&_idle_waits_lock);
+
+    if (wait == NULL && (wait = calloc(1, sizeof(*wait))) != NULL)
+    {
+        const esp_timer_create_args_t args = {
+            .callback = _precise_wait_callback,
+            .arg = wait,
+            .name = "ds18b20_wait",
+        };
+        wait->signal = xSemaphoreCreateBinary();
+        if (wait->signal == NULL || esp_timer_create(&args, &wait->timer) != ESP_OK)
+        {
+            if (wait->signal)
+            {
+                vSemaphoreDelete(wait->signal);
+            }
+            free(wait);
+            wait = NULL;
+        }
+    }
+    return wait;
 }
 
-static size_t _min(size_t x, size_t y)
+static void _release_wait(PreciseWait * wait)
 {
-    return x > y ? y : x;
+    portENTER_CRITICAL(&_idle_waits_lock);
+    wait->next = _idle_waits;
+    _idle_waits = wait;
+    portEXIT_CRITICAL(&_idle_waits_lock);
 }
 
-static DS18B20_ERROR _read_scratchpad(const DS18B20_Info * ds18b20_info, Scratchpad * scratchpad, size_t count)
+static DS18B20_ERROR _wait_precise(const DS18B20_Info * ds18b20_info, uint32_t poll_interval_us, uint32_t * elapsed_us, bool poll)
 {
-    // If CRC is enabled, regardless of count, read the entire scratchpad and verify the CRC,
-    // otherwise read up to the scratchpad size, or count, whichever is smaller.
-
-    if (!scratchpad) {
-        return DS18B20_ERROR_NULL;
-    }
-
     DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
+    int64_t start_time = esp_timer_get_time();
 
-    if (ds18b20_info->use_crc)
-    {
-        count = sizeof(Scratchpad);
-    }
-    count = _min(sizeof(Scratchpad), count);   // avoid reading past end of scratchpad
+    // when the devices can signal completion, allow for overtime beyond the datasheet value,
+    // otherwise wait for the (possibly calibrated) maximum conversion time
+    int64_t conversion_time = poll ? _timing(ds18b20_info->resolution)->timeout_us
+                                   : _device_conversion_time_us(ds18b20_info);
 
-    ESP_LOGD(TAG, "scratchpad read: CRC %d, count %d", ds18b20_info->use_crc, count);
-    if (_address_device(ds18b20_info))
+    PreciseWait * wait = _acquire_wait();
+    if (wait != NULL)
     {
-        // read scratchpad
-        if (owb_write_byte(ds18b20_info->bus, DS18B20_FUNCTION_SCRATCHPAD_READ) == OWB_STATUS_OK)
+        wait->bus = ds18b20_info->bus;
+        wait->timeout = start_time + conversion_time;
+        wait->poll = poll;
+        wait->complete = false;
+        wait->done = false;
+        if (poll)
         {
-            if (owb_read_bytes(ds18b20_info->bus, (uint8_t *)scratchpad, count) == OWB_STATUS_OK)
-            {
-                ESP_LOG_BUFFER_HEX_LEVEL(TAG, scratchpad, count, ESP_LOG_DEBUG);
-
-                err = DS18B20_OK;
-                if (!ds18b20_info->use_crc)
-                {
-                    // Without CRC, or partial read:
-                    ESP_LOGD(TAG, "No CRC check");
-                    bool is_present = false;
-                    owb_reset(ds18b20_info->bus, &is_present);  // terminate early
-                }
-                else
-                {
-                    // With CRC:
-                    if (owb_crc8_bytes(0, (uint8_t *)scratchpad, sizeof(*scratchpad)) != 0)
-                    {
-                        ESP_LOGE(TAG, "CRC failed");
-                        err = DS18B20_ERROR_CRC;
-                    }
-                    else
-                    {
-                        ESP_LOGD(TAG, "CRC ok");
-                    }
-                }
-            }
-            else
-            {
-                ESP_LOGE(TAG, "owb_read_bytes failed");
-                err = DS18B20_ERROR_OWB;
-            }
+            esp_timer_start_periodic(wait->timer, poll_interval_us);
         }
         else
         {
-            ESP_LOGE(TAG, "owb_write_byte failed");
-            err = DS18B20_ERROR_OWB;
+            esp_timer_start_once(wait->timer, conversion_time);
+        }
+
+        // given exactly once per wait, so it is empty again on return
+        xSemaphoreTake(wait->signal, portMAX_DELAY);
+
+        err = wait->complete ? DS18B20_OK : DS18B20_ERROR_DEVICE;
+        int64_t elapsed = wait->end_time - start_time;
+        _release_wait(wait);
+
+        if (poll)
+        {
+            _stats_conversion(ds18b20_info, elapsed, err != DS18B20_OK);
+        }
+        if (err != DS18B20_OK)
+        {
+            ESP_LOGW(TAG, "conversion timed out");
+        }
+        if (elapsed_us)
+        {
+            *elapsed_us = (uint32_t)elapsed;
         }
+        ESP_LOGD(TAG, "conversion took %" PRId64 " us", elapsed);
     }
     else
     {
-        err = DS18B20_ERROR_DEVICE;
+        ESP_LOGE(TAG, "failed to create wait timer");
+        _release_pullup(ds18b20_info->bus);
     }
     return err;
 }
 
-static bool _write_scratchpad(const DS18B20_Info * ds18b20_info, const Scratchpad * scratchpad, bool verify)
+static uint8_t _resolution_config(DS18B20_RESOLUTION resolution)
 {
-    bool result = false;
-    // Only bytes 2, 3 and 4 (trigger and configuration) can be written.
-    // All three bytes MUST be written before the next reset to avoid corruption.
-    if (_is_init(ds18b20_info))
-    {
-        if (_address_device(ds18b20_info))
-        {
-            ESP_LOGD(TAG, "scratchpad write 3 bytes:");
-            ESP_LOG_BUFFER_HEX_LEVEL(TAG, &scratchpad->trigger_high, 3, ESP_LOG_DEBUG);
-            owb_write_byte(ds18b20_info->bus, DS18B20_FUNCTION_SCRATCHPAD_WRITE);
-            owb_write_bytes(ds18b20_info->bus, (uint8_t *)&scratchpad->trigger_high, 3);
-            result = true;
-
-            if (verify)
-            {
-                Scratchpad read = {0};
-                if (_read_scratchpad(ds18b20_info, &read, offsetof(Scratchpad, configuration) + 1) == DS18B20_OK)
-                {
-                    if (memcmp(&scratchpad->trigger_high, &read.trigger_high, 3) != 0)
-                    {
-                        ESP_LOGE(TAG, "scratchpad verify failed: "
-                                 "wrote {0x%02x, 0x%02x, 0x%02x}, "
-                                 "read {0x%02x, 0x%02x, 0x%02x}",
-                                 scratchpad->trigger_high, scratchpad->trigger_low, scratchpad->configuration,
-                                 read.trigger_high, read.trigger_low, read.configuration);
-                        result = false;
-                    }
-                }
-                else
-                {
-                    ESP_LOGE(TAG, "read scratchpad failed");
-                    result = false;
-                }
-            }
-        }
-    }
-    return result;
+    return (((resolution - 1) & 0x03) << 5) | 0x1f;
 }
 
-
-// Public API
-
-DS18B20_Info * ds18b20_malloc(void)
+static int16_t _decode_raw(uint8_t lsb, uint8_t msb, DS18B20_RESOLUTION resolution)
 {
-    DS18B20_Info * ds18b20_info = malloc(sizeof(*ds18b20_info));
-    if (ds18b20_info != NULL)
+    int16_t raw = 0;
+    if (_check_resolution(resolution))
     {
-        memset(ds18b20_info, 0, sizeof(*ds18b20_info));
-        ESP_LOGD(TAG, "malloc %p", ds18b20_info);
+        // masks to remove undefined bits from result
+        static const uint8_t lsb_mask[4] = { ~0x07, ~0x03, ~0x01, ~0x00 };
+        uint8_t lsb_masked = lsb_mask[resolution - DS18B20_RESOLUTION_9_BIT] & lsb;
+        raw = (msb << 8) | lsb_masked;
     }
     else
     {
-        ESP_LOGE(TAG, "malloc failed");
+        ESP_LOGE(TAG, "Unsupported resolution %d", resolution);
     }
-
-    return ds18b20_info;
+    return raw;
 }
 
-void ds18b20_free(DS18B20_Info ** ds18b20_info)
+static float _raw_to_float(int16_t raw)
 {
-    if (ds18b20_info != NULL && (*ds18b20_info != NULL))
-    {
-        ESP_LOGD(TAG, "free %p", *ds18b20_info);
-        free(*ds18b20_info);
-        *ds18b20_info = NULL;
-    }
+    // multiply rather than divide, to avoid a soft-float division
+    return raw * (1.0f / 16.0f);
 }
 
-void ds18b20_init(DS18B20_Info * ds18b20_info, const OneWireBus * bus, OneWireBus_ROMCode rom_code)
+static bool _is_power_on_value(const Scratchpad * scratchpad)
 {
+    // https://github.com/cpetrich/counterfeit_DS18B20#solution-to-the-85-c-problem
+    return scratchpad->reserved[1] == 0x0c && scratchpad->temperature[1] == 0x05 && scratchpad->temperature[0] == 0x50;
+}
+
+static size_t _min(size_t x, size_t y)
+{
+    return x > y ? y : x;
+}
+
+static DS18B20_ERROR _transfer_scratchpad_once(const DS18B20_Info * ds18b20_info, Scratchpad * scratchpad, size_t count, bool use_crc)
+{
+    // Bus transaction only - no validation or logging, so that this can be used
+    // on the batch read path. The caller is responsible for the value of count.
+    _lock_bus(ds18b20_info);
+    int64_t start_time = STATS_TIME();
+    DS18B20_ERROR err = _select_device_command(ds18b20_info, DS18B20_FUNCTION_SCRATCHPAD_READ);
+    if (err != DS18B20_ERROR_DEVICE)
+    {
+        if (err == DS18B20_OK && owb_read_bytes(ds18b20_info->bus, (uint8_t *)scratchpad, count) != OWB_STATUS_OK)
+        {
+            err = DS18B20_ERROR_OWB;
+        }
+        if (err == DS18B20_OK)
+        {
+            if (!use_crc)
+            {
+                // Without CRC, or partial read:
+                bool is_present = false;
+                owb_reset(ds18b20_info->bus, &is_present);  // terminate early
+                STATS_INC(ds18b20_info, resets);
+            }
+            else if (owb_crc8_bytes(0, (uint8_t *)scratchpad, sizeof(*scratchpad)) != 0)
+            {
+                err = DS18B20_ERROR_CRC;
+                STATS_INC(ds18b20_info, crc_failures);
+            }
+        }
+        _stats_bus_time(ds18b20_info, DS18B20_BUS_OP_SCRATCHPAD_READ, start_time);
+    }
+    _unlock_bus(ds18b20_info);
+    return err;
+}
+
+static void _retry_delay(uint32_t delay_us)
+{
+    // busy-wait only for delays shorter than a tick, yield the CPU for anything longer
+    // so that a long backoff does not stall the core or trip the task watchdog
+    if (delay_us < portTICK_PERIOD_MS * 1000)
+    {
+        esp_rom_delay_us(delay_us);
+    }
+    else
+    {
+        vTaskDelay(DS18B20_US_TO_TICKS(delay_us));
+    }
+}
+
+static DS18B20_ERROR _transfer_scratchpad(const DS18B20_Info * ds18b20_info, Scratchpad * scratchpad, size_t count, bool use_crc)
+{
+    // The conversion result remains latched in the device, so a failed read can simply be
+    // repeated. CRC and bus errors are treated as transient noise, whereas a missing presence
+    // pulse usually means the device has gone, so each has its own budget of retries.
+    unsigned int crc_attempts = 0;
+    unsigned int presence_attempts = 0;
+    DS18B20_ERROR err = _transfer_scratchpad_once(ds18b20_info, scratchpad, count, use_crc);
+    while (err != DS18B20_OK)
+    {
+        unsigned int attempt = 0;
+        if (err == DS18B20_ERROR_DEVICE && presence_attempts < ds18b20_info->presence_retries)
+        {
+            attempt = ++presence_attempts;
+        }
+        else if (err != DS18B20_ERROR_DEVICE && crc_attempts < ds18b20_info->crc_retries)
+        {
+            attempt = ++crc_attempts;
+        }
+        else
+        {
+            break;
+        }
+
+        // exponential backoff, bounded to 2^7 times the base delay
+        STATS_INC(ds18b20_info, retries);
+        _retry_delay((uint32_t)ds18b20_info->retry_backoff_us << _min(attempt - 1, 7));
+        err = _transfer_scratchpad_once(ds18b20_info, scratchpad, count, use_crc);
+    }
+    return err;
+}
+
+static size_t _scratchpad_count(const DS18B20_Info * ds18b20_info, size_t count)
+{
+    // If CRC is enabled, regardless of count, read the entire scratchpad and verify the CRC,
+    // otherwise read up to the scratchpad size, or count, whichever is smaller.
+    if (ds18b20_info->use_crc)
+    {
+        count = sizeof(Scratchpad);
+    }
+    return _min(sizeof(Scratchpad), count);   // avoid reading past end of scratchpad
+}
+
+static size_t _temp_read_count(const DS18B20_Info * ds18b20_info)
+{
+    // a restored configuration is verified by extending the first temperature read
+    // up to and including the configuration register, avoiding a separate transaction
+    return ds18b20_info->config_unverified ? offsetof(Scratchpad, configuration) + 1 : 2;
+}
+
+static bool _config_cached(const DS18B20_Info * ds18b20_info)
+{
+    // a restored configuration may be stale, so it cannot stand in for the device until confirmed
+    return ds18b20_info->config_valid && !ds18b20_info->config_unverified;
+}
+
+static bool _all_init(DS18B20_Info * const devices[], size_t count)
+{
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; ++i)
+    {
+        ok = _is_init(devices[i]);
+    }
+    return ok;
+}
+
+static void _collect(DS18B20_ERROR err, size_t index, DS18B20_ERROR * errs, DS18B20_ERROR * result)
+{
+    // record one device's result in a batch, which reports the first failure
+    if (errs)
+    {
+        errs[index] = err;
+    }
+    if (*result == DS18B20_OK)
+    {
+        *result = err;
+    }
+}
+
+static void _verify_restored_config(DS18B20_Info * info, const Scratchpad * scratchpad)
+{
+    if (info->config_unverified)
+    {
+        DS18B20_RESOLUTION resolution = ((scratchpad->configuration >> 5) & 0x03) + DS18B20_RESOLUTION_9_BIT;
+        if (info->config_valid && (info->configuration != scratchpad->configuration || info->resolution != resolution))
+        {
+            ESP_LOGW(TAG, "restored configuration 0x%02x does not match device 0x%02x", info->configuration, scratchpad->configuration);
+        }
+        info->resolution = resolution;
+        info->trigger_high = scratchpad->trigger_high;
+        info->trigger_low = scratchpad->trigger_low;
+        info->configuration = scratchpad->configuration;
+        info->config_valid = true;
+        info->config_unverified = false;
+    }
+}
+
+static bool _is_plausible(const DS18B20_Info * ds18b20_info, const Scratchpad * scratchpad)
+{
+    int16_t raw = (int16_t)((scratchpad->temperature[1] << 8) | scratchpad->temperature[0]);
+
+    // configuration register bit 7 is always 0, bits 0 to 4 are always 1
+    bool plausible = (scratchpad->configuration & 0x9f) == 0x1f;
+    if (ds18b20_info->config_valid)
+    {
+        plausible = plausible && scratchpad->trigger_high == ds18b20_info->trigger_high
+                              && scratchpad->trigger_low == ds18b20_info->trigger_low
+                              && scratchpad->configuration == ds18b20_info->configuration;
+    }
+
+    // the power-on value can only be confirmed from the reserved bytes, so treat it as an anomaly
+    plausible = plausible && !(scratchpad->temperature[1] == 0x05 && scratchpad->temperature[0] == 0x50);
+
+    // operating range is -55 to +125 degrees Celsius
+    plausible = plausible && raw >= -55 * 16 && raw <= 125 * 16;
+
+    if (ds18b20_info->last_valid && ds18b20_info->max_step > 0)
+    {
+        plausible = plausible && abs(raw - ds18b20_info->last_raw) <= ds18b20_info->max_step;
+    }
+    return plausible;
+}
+
+static DS18B20_ERROR _read_checked(DS18B20_Info * info, Scratchpad * scratchpad)
+{
+    // Read only up to the configuration register and check the result for plausibility,
+    // falling back to a full CRC-checked read on an anomaly, or every crc_interval reads.
+    // The conversion result remains latched in the device, so it can be read again.
+    DS18B20_ERROR err = DS18B20_OK;
+    bool full = false;
+    if (info->crc_interval > 0 && ++info->crc_count >= info->crc_interval)
+    {
+        info->crc_count = 0;
+        full = true;
+    }
+
+    if (!full)
+    {
+        err = _transfer_scratchpad(info, scratchpad, offsetof(Scratchpad, configuration) + 1, false);
+        if (err == DS18B20_OK && !_is_plausible(info, scratchpad))
+        {
+            full = true;
+            STATS_INC(info, retries);
+        }
+    }
+
+    if (full)
+    {
+        err = _transfer_scratchpad(info, scratchpad, sizeof(*scratchpad), true);
+    }
+
+    if (err == DS18B20_OK)
+    {
+        info->last_raw = (int16_t)((scratchpad->temperature[1] << 8) | scratchpad->temperature[0]);
+        info->last_valid = true;
+    }
+    return err;
+}
+
+static bool _use_checked_read(const DS18B20_Info * ds18b20_info)
+{
+    // a full CRC check makes the plausibility checks redundant
+    return ds18b20_info->use_plausibility_check && !ds18b20_info->use_crc;
+}
+
+static DS18B20_ERROR _read_scratchpad(const DS18B20_Info * ds18b20_info, Scratchpad * scratchpad, size_t count)
+{
+    if (!scratchpad) {
+        return DS18B20_ERROR_NULL;
+    }
+
+    DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
+
+    count = _scratchpad_count(ds18b20_info, count);
+    HOT_LOGD(TAG, "scratchpad read: CRC %d, count %zu", ds18b20_info->use_crc, count);
+    if (HOT_IS_INIT(ds18b20_info))
+    {
+        err = _transfer_scratchpad(ds18b20_info, scratchpad, count, ds18b20_info->use_crc);
+        switch (err)
+        {
+            case DS18B20_OK:
+                HOT_LOG_BUFFER_HEX(TAG, scratchpad, count);
+                HOT_LOGD(TAG, "%s", ds18b20_info->use_crc ? "CRC ok" : "No CRC check");
+                break;
+            case DS18B20_ERROR_CRC:
+                ESP_LOGE(TAG, "CRC failed");
+                break;
+            case DS18B20_ERROR_DEVICE:
+                ESP_LOGE(TAG, "ds18b20 device not responding");
+                break;
+            default:
+                ESP_LOGE(TAG, "scratchpad read failed");
+                break;
+        }
+    }
+    else
+    {
+        err = DS18B20_ERROR_DEVICE;
+    }
+    return err;
+}
+
+static bool _write_scratchpad(const DS18B20_Info * ds18b20_info, const Scratchpad * scratchpad, bool verify)
+{
+    bool result = false;
+    // Only bytes 2, 3 and 4 (trigger and configuration) can be written.
+    // All three bytes MUST be written before the next reset to avoid corruption.
+    if (_is_init(ds18b20_info))
+    {
+        _lock_bus(ds18b20_info);
+        int64_t start_time = STATS_TIME();
+        if (_address_device(ds18b20_info))
+        {
+            owb_write_byte(ds18b20_info->bus, DS18B20_FUNCTION_SCRATCHPAD_WRITE);
+            owb_write_bytes(ds18b20_info->bus, (uint8_t *)&scratchpad->trigger_high, 3);
+            _stats_bus_time(ds18b20_info, DS18B20_BUS_OP_SCRATCHPAD_WRITE, start_time);
+            result = true;
+            ESP_LOGD(TAG, "scratchpad write 3 bytes:");
+            ESP_LOG_BUFFER_HEX_LEVEL(TAG, &scratchpad->trigger_high, 3, ESP_LOG_DEBUG);
+
+            // keep the lock so that the verify reads back what was written
+            if (verify)
+            {
+                Scratchpad read = {0};
+                if (_read_scratchpad(ds18b20_info, &read, offsetof(Scratchpad, configuration) + 1) == DS18B20_OK)
+                {
+                    if (memcmp(&scratchpad->trigger_high, &read.trigger_high, 3) != 0)
+                    {
+                        ESP_LOGE(TAG, "scratchpad verify failed: "
+                                 "wrote {0x%02x, 0x%02x, 0x%02x}, "
+                                 "read {0x%02x, 0x%02x, 0x%02x}",
+                                 scratchpad->trigger_high, scratchpad->trigger_low, scratchpad->configuration,
+                                 read.trigger_high, read.trigger_low, read.configuration);
+                        result = false;
+                    }
+                }
+                else
+                {
+                    ESP_LOGE(TAG, "read scratchpad failed");
+                    result = false;
+                }
+            }
+        }
+        _unlock_bus(ds18b20_info);
+    }
+    return result;
+}
+
+static void _recover_power_on(DS18B20_Info * info, const Scratchpad * scratchpad)
+{
+    // The device has restarted with its EEPROM configuration. The scratchpad was read in full,
+    // so restore the cached configuration only if it differs.
+    if (info->config_valid
+        && (scratchpad->trigger_high != info->trigger_high
+            || scratchpad->trigger_low != info->trigger_low
+            || scratchpad->configuration != info->configuration))
+    {
+        Scratchpad restore = *scratchpad;
+        restore.trigger_high = info->trigger_high;
+        restore.trigger_low = info->trigger_low;
+        restore.configuration = info->configuration;
+        if (_write_scratchpad(info, &restore, /* verify */ false))
+        {
+            // confirmed by extending the next temperature read, rather than a separate transaction
+            info->config_unverified = true;
+        }
+        ESP_LOGW(TAG, "power-on reset detected - configuration 0x%02x re-applied", info->configuration);
+    }
+    else if (!info->config_valid)
+    {
+        // nothing to restore, so adopt the device's configuration
+        info->trigger_high = scratchpad->trigger_high;
+        info->trigger_low = scratchpad->trigger_low;
+        info->configuration = scratchpad->configuration;
+        info->resolution = ((scratchpad->configuration >> 5) & 0x03) + DS18B20_RESOLUTION_9_BIT;
+        info->config_valid = true;
+        ESP_LOGW(TAG, "power-on reset detected - configuration 0x%02x adopted", info->configuration);
+    }
+
+    // a parasitically powered conversion would hold the bus, and stop the rest of a batch read
+    if (!info->bus->use_parasitic_power)
+    {
+        ds18b20_convert(info);
+    }
+}
+
+static bool _detect_power_on(DS18B20_Info * ds18b20_info, Scratchpad * scratchpad)
+{
+    bool power_on = _is_power_on_value(scratchpad);
+    if (!power_on && ds18b20_info->use_power_on_recovery && scratchpad->reserved[1] == 0
+        && scratchpad->temperature[1] == 0x05 && scratchpad->temperature[0] == 0x50)
+    {
+        // a partial read cannot tell the power-on value from a genuine 85 degrees, so read the rest
+        Scratchpad full = {0};
+        if (_transfer_scratchpad(ds18b20_info, &full, sizeof(full), true) == DS18B20_OK)
+        {
+            *scratchpad = full;
+            power_on = _is_power_on_value(scratchpad);
+        }
+    }
+
+    if (power_on)
+    {
+        STATS_INC(ds18b20_info, power_on_values);
+        if (ds18b20_info->use_power_on_recovery)
+        {
+            _recover_power_on(ds18b20_info, scratchpad);
+        }
+    }
+    return power_on;
+}
+
+static bool _write_config(DS18B20_Info * ds18b20_info, uint8_t trigger_high, uint8_t trigger_low, uint8_t configuration)
+{
+    // Write the alarm triggers and configuration register, unless the cache shows that
+    // the device already holds these values. The cache is updated to match.
+    bool result = true;
+    if (!_config_cached(ds18b20_info)
+        || ds18b20_info->trigger_high != trigger_high
+        || ds18b20_info->trigger_low != trigger_low
+        || ds18b20_info->configuration != configuration)
+    {
+        Scratchpad scratchpad = {0};
+        scratchpad.trigger_high = trigger_high;
+        scratchpad.trigger_low = trigger_low;
+        scratchpad.configuration = configuration;
+
+        // write bytes 2, 3 and 4 of scratchpad
+        result = _write_scratchpad(ds18b20_info, &scratchpad, /* verify */ true);
+        if (result)
+        {
+            ds18b20_info->trigger_high = trigger_high;
+            ds18b20_info->trigger_low = trigger_low;
+            ds18b20_info->configuration = configuration;
+            ds18b20_info->config_valid = true;
+        }
+        else
+        {
+            // Configuration change failed - update the info resolution with the value read from configuration
+            ds18b20_info->config_valid = false;
+            ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+            ESP_LOGW(TAG, "Resolution consistency lost - refreshed from device: %d", ds18b20_info->resolution);
+        }
+    }
+    else
+    {
+        // hardware already matches - nothing to write
+        ESP_LOGD(TAG, "configuration unchanged");
+    }
+    return result;
+}
+
+static void _wait_for_eeprom(const OneWireBus * bus)
+{
+    // In parasitic power mode the devices must be powered by the strong pullup while
+    // the EEPROM is written, otherwise just wait for the maximum write time.
+    owb_set_strong_pullup(bus, true);
+    vTaskDelay((T_EEPROM + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS + 1);
+    owb_set_strong_pullup(bus, false);
+}
+
+static bool _alarm_search(const OneWireBus * bus, AlarmSearchState * state)
+{
+    // 1-Wire search algorithm (Maxim Application Note 187), using the Alarm Search
+    // command so that only devices with their alarm flag set respond.
+    bool found = false;
+    bool present = false;
+    if (!state->last_device)
+    {
+        owb_reset(bus, &present);
+    }
+
+    if (present)
+    {
+        int id_bit_number = 1;
+        int last_zero = 0;
+        int rom_byte_number = 0;
+        uint8_t rom_byte_mask = 1;
+
+        owb_write_byte(bus, DS18B20_ROM_SEARCH_ALARM);
+        while (rom_byte_number < 8)
+        {
+            uint8_t id_bit = 0;
+            uint8_t cmp_id_bit = 0;
+            owb_read_bit(bus, &id_bit);
+            owb_read_bit(bus, &cmp_id_bit);
+            if (id_bit && cmp_id_bit)
+            {
+                // no devices participating in search
+                break;
+            }
+
+            uint8_t search_direction = 0;
+            if (id_bit != cmp_id_bit)
+            {
+                // all participating devices have the same bit value
+                search_direction = id_bit;
+            }
+            else
+            {
+                // discrepancy - devices with both bit values are present
+                if (id_bit_number < state->last_discrepancy)
+                {
+                    search_direction = (state->rom_code.bytes[rom_byte_number] & rom_byte_mask) ? 1 : 0;
+                }
+                else
+                {
+                    search_direction = (id_bit_number == state->last_discrepancy) ? 1 : 0;
+                }
+                if (search_direction == 0)
+                {
+                    last_zero = id_bit_number;
+                }
+            }
+
+            if (search_direction)
+            {
+                state->rom_code.bytes[rom_byte_number] |= rom_byte_mask;
+            }
+            else
+            {
+                state->rom_code.bytes[rom_byte_number] &= ~rom_byte_mask;
+            }
+            owb_write_bit(bus, search_direction);
+
+            ++id_bit_number;
+            rom_byte_mask <<= 1;
+            if (rom_byte_mask == 0)
+            {
+                ++rom_byte_number;
+                rom_byte_mask = 1;
+            }
+        }
+
+        if (id_bit_number > 64 && owb_crc8_bytes(0, state->rom_code.bytes, sizeof(state->rom_code.bytes)) == 0)
+        {
+            state->last_discrepancy = last_zero;
+            state->last_device = (last_zero == 0);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        state->last_device = true;
+    }
+    return found;
+}
+
+static bool _alarm_search_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock, AlarmSearchState * state)
+{
+    _take_lock(bus_lock);
+    bool found = _alarm_search(bus, state);
+    _give_lock(bus_lock);
+    return found;
+}
+
+
+
+// Public API
+
+DS18B20_Info * ds18b20_malloc(void)
+{
+    DS18B20_Info * ds18b20_info = malloc(sizeof(*ds18b20_info));
     if (ds18b20_info != NULL)
     {
-        _init(ds18b20_info, bus);
-        ds18b20_info->rom_code = rom_code;
+        memset(ds18b20_info, 0, sizeof(*ds18b20_info));
+        ESP_LOGD(TAG, "malloc %p", ds18b20_info);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "malloc failed");
+    }
+
+    return ds18b20_info;
+}
+
+void ds18b20_free(DS18B20_Info ** ds18b20_info)
+{
+    if (ds18b20_info != NULL && (*ds18b20_info != NULL))
+    {
+        ESP_LOGD(TAG, "free %p", *ds18b20_info);
+        free(*ds18b20_info);
+        *ds18b20_info = NULL;
+    }
+}
+
+void ds18b20_pool_init(DS18B20_Pool * pool, DS18B20_Info * storage, size_t capacity)
+{
+    if (pool != NULL && storage != NULL)
+    {
+        memset(storage, 0, capacity * sizeof(*storage));
+        pool->devices = storage;
+        pool->capacity = capacity;
+        pool->count = 0;
+        pool->owned = false;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "pool or storage is NULL");
+    }
+}
+
+DS18B20_Pool * ds18b20_pool_create_with_caps(size_t capacity, uint32_t caps)
+{
+    // a single allocation holds the pool and all of its slots
+    DS18B20_Pool * pool = heap_caps_calloc(1, sizeof(*pool) + capacity * sizeof(DS18B20_Info), caps);
+    if (pool != NULL)
+    {
+        pool->devices = (DS18B20_Info *)(pool + 1);
+        pool->capacity = capacity;
+        pool->count = 0;
+        pool->owned = true;
+        ESP_LOGD(TAG, "pool %p: %zu slots", pool, capacity);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "pool allocation failed");
+    }
+    return pool;
+}
+
+DS18B20_Pool * ds18b20_pool_create(size_t capacity)
+{
+    return ds18b20_pool_create_with_caps(capacity, MALLOC_CAP_DEFAULT);
+}
+
+void ds18b20_pool_free(DS18B20_Pool ** pool)
+{
+    if (pool != NULL && (*pool != NULL))
+    {
+        if ((*pool)->owned)
+        {
+            ESP_LOGD(TAG, "free pool %p", *pool);
+            heap_caps_free(*pool);
+        }
+        *pool = NULL;
+    }
+}
+
+DS18B20_Info * ds18b20_pool_alloc(DS18B20_Pool * pool)
+{
+    DS18B20_Info * ds18b20_info = NULL;
+    if (pool != NULL)
+    {
+        if (pool->count < pool->capacity)
+        {
+            ds18b20_info = &pool->devices[pool->count++];
+        }
+        else
+        {
+            ESP_LOGE(TAG, "pool exhausted");
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "pool is NULL");
+    }
+    return ds18b20_info;
+}
+
+static int _compare_rom_code(const OneWireBus_ROMCode * a, const OneWireBus_ROMCode * b)
+{
+    return memcmp(a->bytes, b->bytes, sizeof(a->bytes));
+}
+
+static int _compare_info(const void * a, const void * b)
+{
+    return _compare_rom_code(&((const DS18B20_Info *)a)->rom_code, &((const DS18B20_Info *)b)->rom_code);
+}
+
+void ds18b20_pool_sort(DS18B20_Pool * pool)
+{
+    if (pool != NULL)
+    {
+        qsort(pool->devices, pool->count, sizeof(*pool->devices), _compare_info);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "pool is NULL");
+    }
+}
+
+DS18B20_Info * ds18b20_pool_find(const DS18B20_Pool * pool, OneWireBus_ROMCode rom_code)
+{
+    DS18B20_Info * ds18b20_info = NULL;
+    if (pool != NULL)
+    {
+        size_t low = 0;
+        size_t high = pool->count;
+        while (low < high && ds18b20_info == NULL)
+        {
+            size_t mid = low + (high - low) / 2;
+            int cmp = _compare_rom_code(&rom_code, &pool->devices[mid].rom_code);
+            if (cmp < 0)
+            {
+                high = mid;
+            }
+            else if (cmp > 0)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                ds18b20_info = &pool->devices[mid];
+            }
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "pool is NULL");
+    }
+    return ds18b20_info;
+}
+
+size_t ds18b20_discover(const OneWireBus * bus, DS18B20_Pool * pool, size_t max)
+{
+    return ds18b20_discover_locked(bus, NULL, pool, max);
+}
+
+size_t ds18b20_discover_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock, DS18B20_Pool * pool, size_t max)
+{
+    if (bus == NULL || pool == NULL)
+    {
+        ESP_LOGE(TAG, "bus or pool is NULL");
+        return 0;
+    }
+
+    // the search is a sequence of passes that other traffic would disrupt, so hold the lock throughout
+    _take_lock(bus_lock);
+
+    // collect the ROM codes first, so that slots can be assigned in sorted order
+    pool->count = 0;
+    max = _min(max, pool->capacity);
+    OneWireBus_SearchState search_state = {0};
+    bool found = false;
+    bool excess = false;
+    owb_search_first(bus, &search_state, &found);
+    while (found && !excess)
+    {
+        if (search_state.rom_code.fields.family[0] != DS18B20_FAMILY_CODE)
+        {
+            ESP_LOGD(TAG, "ignoring device with family 0x%02x", search_state.rom_code.fields.family[0]);
+        }
+        else if (pool->count < max)
+        {
+            pool->devices[pool->count++].rom_code = search_state.rom_code;
+        }
+        else
+        {
+            // only another DS18B20 device is worth a warning, so keep searching past any others
+            excess = true;
+        }
+        owb_search_next(bus, &search_state, &found);
+    }
+    if (excess)
+    {
+        ESP_LOGW(TAG, "more than %zu DS18B20 devices present, ignoring the rest", max);
+    }
+    ds18b20_pool_sort(pool);
+
+    for (size_t i = 0; i < pool->count; ++i)
+    {
+        ds18b20_init(&pool->devices[i], bus, pool->devices[i].rom_code);
+        ds18b20_use_bus_lock(&pool->devices[i], bus_lock);
+    }
+    _give_lock(bus_lock);
+    ESP_LOGD(TAG, "discovered %zu devices", pool->count);
+    return pool->count;
+}
+
+void ds18b20_init(DS18B20_Info * ds18b20_info, const OneWireBus * bus, OneWireBus_ROMCode rom_code)
+{
+    if (ds18b20_info != NULL)
+    {
+        _init(ds18b20_info, bus);
+        ds18b20_info->rom_code = rom_code;
+
+        // read current resolution from device as it may not be power-on or factory default
+        ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "ds18b20_info is NULL");
+    }
+}
+
+void ds18b20_init_with_resolution(DS18B20_Info * ds18b20_info, const OneWireBus * bus, OneWireBus_ROMCode rom_code,
+                                  DS18B20_RESOLUTION resolution)
+{
+    if (ds18b20_info != NULL)
+    {
+        _init(ds18b20_info, bus);
+        ds18b20_info->rom_code = rom_code;
+
+        // trust the caller - the device is not queried
+        ds18b20_info->resolution = _check_resolution(resolution) ? resolution : DS18B20_RESOLUTION_INVALID;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "ds18b20_info is NULL");
+    }
+}
+
+void ds18b20_init_solo(DS18B20_Info * ds18b20_info, const OneWireBus * bus)
+{
+    if (ds18b20_info != NULL)
+    {
+        _init(ds18b20_info, bus);
+        ds18b20_info->solo = true;
+        // ROM code not required
+
+        // read current resolution from device as it may not be power-on or factory default
+        ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "ds18b20_info is NULL");
+    }
+}
+
+void ds18b20_use_crc(DS18B20_Info * ds18b20_info, bool use_crc)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->use_crc = use_crc;
+        ESP_LOGD(TAG, "use_crc %d", ds18b20_info->use_crc);
+    }
+}
+
+void ds18b20_use_bus_lock(DS18B20_Info * ds18b20_info, SemaphoreHandle_t bus_lock)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->bus_lock = bus_lock;
+    }
+}
+
+void ds18b20_set_retry_policy(DS18B20_Info * ds18b20_info, uint8_t crc_retries, uint8_t presence_retries,
+                              uint16_t backoff_us)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->crc_retries = crc_retries;
+        ds18b20_info->presence_retries = presence_retries;
+        ds18b20_info->retry_backoff_us = backoff_us;
+        ESP_LOGD(TAG, "retry policy: crc %d, presence %d, backoff %d us", crc_retries, presence_retries, backoff_us);
+    }
+}
+
+void ds18b20_use_stats(DS18B20_Info * ds18b20_info, DS18B20_Stats * stats)
+{
+    if (_is_init(ds18b20_info))
+    {
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+        ds18b20_info->stats = stats;
+        ESP_LOGD(TAG, "stats %p", stats);
+#else
+        ESP_LOGW(TAG, "stats not enabled - set CONFIG_DS18B20_ENABLE_STATS");
+#endif
+    }
+}
+
+void ds18b20_use_default_stats(DS18B20_Stats * stats)
+{
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+    _default_stats = stats;
+    ESP_LOGD(TAG, "default stats %p", stats);
+#else
+    ESP_LOGW(TAG, "stats not enabled - set CONFIG_DS18B20_ENABLE_STATS");
+#endif
+}
+
+void ds18b20_stats_snapshot(const DS18B20_Stats * stats, DS18B20_Stats * snapshot)
+{
+    if (stats && snapshot)
+    {
+        *snapshot = *stats;
+    }
+}
+
+void ds18b20_stats_reset(DS18B20_Stats * stats)
+{
+    if (stats)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+int ds18b20_stats_format(const DS18B20_Stats * stats, char * buffer, size_t size)
+{
+    static const char * const op_names[DS18B20_BUS_OP_MAX] = {
+        [DS18B20_BUS_OP_CONVERT] = "convert",
+        [DS18B20_BUS_OP_SCRATCHPAD_READ] = "scratchpad_read",
+        [DS18B20_BUS_OP_SCRATCHPAD_WRITE] = "scratchpad_write",
+        [DS18B20_BUS_OP_EEPROM_COPY] = "eeprom_copy",
+    };
+
+    if (!stats || !buffer)
+    {
+        ESP_LOGE(TAG, "stats or buffer is NULL");
+        return -1;
+    }
+
+    // append each part at the current length, even once truncated, so that the total length is returned
+    size_t length = 0;
+    int n = snprintf(buffer, size, "{\"conversions\":%" PRIu32 ",\"conversion_timeouts\":%" PRIu32 ",\"conversion_histogram\":[",
+                     stats->conversions, stats->conversion_timeouts);
+    for (int i = 0; n >= 0 && i < DS18B20_STATS_HISTOGRAM_BUCKETS; ++i)
+    {
+        length += n;
+        n = snprintf(buffer + _min(length, size), size - _min(length, size), "%s%" PRIu32,
+                     i ? "," : "", stats->conversion_histogram[i]);
+    }
+    for (int op = 0; n >= 0 && op < DS18B20_BUS_OP_MAX; ++op)
+    {
+        length += n;
+        const DS18B20_BusTime * bus_time = &stats->bus_time[op];
+        n = snprintf(buffer + _min(length, size), size - _min(length, size),
+                     "%s\"%s\":{\"count\":%" PRIu32 ",\"max_us\":%" PRIu32 ",\"total_us\":%" PRIu64 "}",
+                     op ? "," : "],\"bus_time\":{", op_names[op], bus_time->count, bus_time->max_us, bus_time->total_us);
+    }
+    if (n >= 0)
+    {
+        length += n;
+        n = snprintf(buffer + _min(length, size), size - _min(length, size),
+                     "},\"resets\":%" PRIu32 ",\"crc_failures\":%" PRIu32 ",\"power_on_values\":%" PRIu32
+                     ",\"not_present\":%" PRIu32 ",\"retries\":%" PRIu32 "}",
+                     stats->resets, stats->crc_failures, stats->power_on_values, stats->not_present, stats->retries);
+    }
+    return n >= 0 ? (int)(length + n) : n;
+}
+
+void ds18b20_use_plausibility_check(DS18B20_Info * ds18b20_info, bool use_plausibility_check,
+                                    uint16_t max_step, uint8_t crc_interval)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->use_plausibility_check = use_plausibility_check;
+        ds18b20_info->max_step = max_step;
+        ds18b20_info->crc_interval = crc_interval;
+        ds18b20_info->crc_count = 0;
+        ds18b20_info->last_valid = false;
+        ESP_LOGD(TAG, "use_plausibility_check %d, max_step %d, crc_interval %d",
+                 use_plausibility_check, max_step, crc_interval);
+    }
+}
+
+void ds18b20_use_calibration(DS18B20_Info * ds18b20_info, bool use_calibration)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->use_calibration = use_calibration;
+        ESP_LOGD(TAG, "use_calibration %d", ds18b20_info->use_calibration);
+    }
+}
+
+void ds18b20_use_low_power_wait(DS18B20_Info * ds18b20_info, bool use_low_power_wait)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->use_low_power_wait = use_low_power_wait;
+    }
+}
+
+void ds18b20_use_power_on_recovery(DS18B20_Info * ds18b20_info, bool use_power_on_recovery)
+{
+    if (_is_init(ds18b20_info))
+    {
+        ds18b20_info->use_power_on_recovery = use_power_on_recovery;
+    }
+}
+
+void ds18b20_calibration_update(DS18B20_Info * ds18b20_info, uint32_t elapsed_us)
+{
+    if (_is_init(ds18b20_info) && _check_resolution(ds18b20_info->resolution))
+    {
+        // conversion time halves with each bit of resolution removed, so keep the
+        // running maximum as the equivalent 12-bit value
+        uint32_t normalised = elapsed_us << (DS18B20_RESOLUTION_12_BIT - ds18b20_info->resolution);
+        if (normalised > ds18b20_info->calibrated_conversion_us)
+        {
+            ds18b20_info->calibrated_conversion_us = normalised;
+            ESP_LOGD(TAG, "calibrated conversion time %" PRIu32 " us", ds18b20_info->calibrated_conversion_us);
+        }
+    }
+}
+
+DS18B20_ERROR ds18b20_calibrate(DS18B20_Info * ds18b20_info, unsigned int samples)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (_is_init(ds18b20_info))
+    {
+        if (ds18b20_info->bus->use_parasitic_power)
+        {
+            ESP_LOGE(TAG, "calibration requires external power mode");
+            err = DS18B20_ERROR_DEVICE;
+        }
+        else
+        {
+            // measuring requires the completion signal, so poll for it even in low-power mode,
+            // keeping any other users off a shared bus for the duration
+            _lock_bus(ds18b20_info);
+            err = DS18B20_OK;
+            for (unsigned int i = 0; i < samples && err == DS18B20_OK; ++i)
+            {
+                uint32_t elapsed_us = 0;
+                err = DS18B20_ERROR_DEVICE;
+                if (ds18b20_convert(ds18b20_info)
+                    && (err = _wait_precise(ds18b20_info, DS18B20_DEFAULT_POLL_INTERVAL_US, &elapsed_us, true)) == DS18B20_OK)
+                {
+                    ds18b20_calibration_update(ds18b20_info, elapsed_us);
+                }
+            }
+            _unlock_bus(ds18b20_info);
+        }
+    }
+    return err;
+}
+
+bool ds18b20_set_resolution(DS18B20_Info * ds18b20_info, DS18B20_RESOLUTION resolution)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info))
+    {
+        if (_check_resolution(resolution))
+        {
+            // configuration register value for the requested resolution
+            uint8_t value = _resolution_config(resolution);
+            ESP_LOGD(TAG, "configuration value 0x%02x", value);
+
+            // read scratchpad up to and including configuration register, unless already cached
+            if (!_config_cached(ds18b20_info))
+            {
+                ds18b20_read_resolution(ds18b20_info);
+            }
+
+            // modify configuration register to set resolution, preserving the alarm triggers
+            result = _write_config(ds18b20_info, ds18b20_info->trigger_high, ds18b20_info->trigger_low, value);
+            if (result)
+            {
+                ds18b20_info->resolution = resolution;
+                ESP_LOGD(TAG, "Resolution set to %d bits", (int)resolution);
+            }
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Unsupported resolution %d", resolution);
+        }
+    }
+    return result;
+}
+
+bool ds18b20_set_alarm(DS18B20_Info * ds18b20_info, int8_t high, int8_t low)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info))
+    {
+        if (high >= low)
+        {
+            // read scratchpad up to and including configuration register, unless already cached
+            if (!_config_cached(ds18b20_info))
+            {
+                ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+            }
+
+            if (ds18b20_info->config_valid)
+            {
+                // modify alarm triggers, preserving the configuration register
+                result = _write_config(ds18b20_info, (uint8_t)high, (uint8_t)low, ds18b20_info->configuration);
+                if (result)
+                {
+                    ESP_LOGD(TAG, "Alarm set to %d, %d", high, low);
+                }
+            }
+            else
+            {
+                ESP_LOGE(TAG, "configuration could not be read");
+            }
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Invalid alarm range %d, %d", high, low);
+        }
+    }
+    return result;
+}
+
+bool ds18b20_read_alarm(DS18B20_Info * ds18b20_info, int8_t * high, int8_t * low)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info))
+    {
+        if (!_config_cached(ds18b20_info))
+        {
+            ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+        }
+
+        if (ds18b20_info->config_valid)
+        {
+            if (high)
+            {
+                *high = (int8_t)ds18b20_info->trigger_high;
+            }
+            if (low)
+            {
+                *low = (int8_t)ds18b20_info->trigger_low;
+            }
+            result = true;
+        }
+    }
+    return result;
+}
+
+bool ds18b20_save_config(const DS18B20_Info * ds18b20_info)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info))
+    {
+        _lock_bus(ds18b20_info);
+        int64_t start_time = STATS_TIME();
+        if (_address_device(ds18b20_info))
+        {
+            owb_write_byte(ds18b20_info->bus, DS18B20_FUNCTION_SCRATCHPAD_COPY);
+            _wait_for_eeprom(ds18b20_info->bus);
+            _stats_bus_time(ds18b20_info, DS18B20_BUS_OP_EEPROM_COPY, start_time);
+            result = true;
+            ESP_LOGD(TAG, "scratchpad copied to EEPROM");
+        }
+        _unlock_bus(ds18b20_info);
+    }
+    return result;
+}
+
+bool ds18b20_recall_eeprom(DS18B20_Info * ds18b20_info)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info))
+    {
+        _lock_bus(ds18b20_info);
+        if (_address_device(ds18b20_info))
+        {
+            // the device responds to read slots with 0 while the recall is in progress
+            owb_write_byte(ds18b20_info->bus, DS18B20_FUNCTION_EEPROM_RECALL);
+            uint8_t status = 0;
+            for (int i = 0; i < T_RECALL_SLOTS && status == 0; ++i)
+            {
+                owb_read_bit(ds18b20_info->bus, &status);
+            }
+            result = (status != 0);
+        }
+        _unlock_bus(ds18b20_info);
+
+        if (result)
+        {
+            ESP_LOGD(TAG, "EEPROM recalled to scratchpad");
+            ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+            result = ds18b20_info->config_valid;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "EEPROM recall failed");
+            ds18b20_info->config_valid = false;
+        }
+    }
+    return result;
+}
+
+DS18B20_ERROR ds18b20_configure_all(DS18B20_Info * const devices[], size_t count, DS18B20_RESOLUTION resolution,
+                                    int8_t high, int8_t low, bool save, DS18B20_ERROR * errs)
+{
+    if (!devices)
+    {
+        ESP_LOGE(TAG, "devices is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (count == 0)
+    {
+        return DS18B20_OK;
+    }
+    if (!_all_init(devices, count))
+    {
+        return DS18B20_ERROR_NULL;
+    }
+    if (!_check_resolution(resolution) || high < low)
+    {
+        ESP_LOGE(TAG, "invalid resolution %d or alarm range %d, %d", resolution, high, low);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    // the broadcast only reaches the first device's bus, under its lock
+    const OneWireBus * bus = devices[0]->bus;
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (devices[i]->bus != bus || devices[i]->bus_lock != devices[0]->bus_lock)
+        {
+            ESP_LOGE(TAG, "device %zu is not on the same bus as device 0", i);
+            return DS18B20_ERROR_ARGUMENT;
+        }
+    }
+
+    Scratchpad expected = {0};
+    expected.trigger_high = (uint8_t)high;
+    expected.trigger_low = (uint8_t)low;
+    expected.configuration = _resolution_config(resolution);
+
+    // the whole sequence is one unit as far as other users of the bus are concerned
+    _lock_bus(devices[0]);
+    DS18B20_ERROR result = DS18B20_ERROR_DEVICE;
+    bool is_present = false;
+    owb_reset(bus, &is_present);
+    if (is_present)
+    {
+        owb_write_byte(bus, OWB_ROM_SKIP);
+        owb_write_byte(bus, DS18B20_FUNCTION_SCRATCHPAD_WRITE);
+        owb_write_bytes(bus, &expected.trigger_high, 3);
+        result = DS18B20_OK;
+
+        if (save)
+        {
+            owb_reset(bus, &is_present);
+            owb_write_byte(bus, OWB_ROM_SKIP);
+            owb_write_byte(bus, DS18B20_FUNCTION_SCRATCHPAD_COPY);
+            _wait_for_eeprom(bus);
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "no devices responding");
+    }
+
+    // Verify each device with a partial read, ending at the configuration register:
+    // the temperature bytes precede it and cannot be skipped. A failure to verify one device
+    // is reported for that device only, as the broadcast reached the others.
+    DS18B20_ERROR written = result;
+    for (size_t i = 0; i < count; ++i)
+    {
+        DS18B20_Info * ds18b20_info = devices[i];
+        DS18B20_ERROR err = written;
+        if (err == DS18B20_OK)
+        {
+            Scratchpad scratchpad = {0};
+            err = _transfer_scratchpad(ds18b20_info, &scratchpad, offsetof(Scratchpad, configuration) + 1, false);
+            if (err == DS18B20_OK && memcmp(&scratchpad.trigger_high, &expected.trigger_high, 3) != 0)
+            {
+                ESP_LOGE(TAG, "device %zu verify failed: read {0x%02x, 0x%02x, 0x%02x}", i,
+                         scratchpad.trigger_high, scratchpad.trigger_low, scratchpad.configuration);
+                err = DS18B20_ERROR_DEVICE;
+            }
+        }
+
+        if (err == DS18B20_OK)
+        {
+            ds18b20_info->trigger_high = expected.trigger_high;
+            ds18b20_info->trigger_low = expected.trigger_low;
+            ds18b20_info->configuration = expected.configuration;
+            ds18b20_info->resolution = resolution;
+            ds18b20_info->config_valid = true;
+            ds18b20_info->config_unverified = false;
+        }
+        else
+        {
+            // the device's configuration is unknown until it is next read
+            ds18b20_info->config_valid = false;
+        }
+
+        _collect(err, i, errs, &result);
+    }
+    _unlock_bus(devices[0]);
+
+    ESP_LOGD(TAG, "configured %zu devices: %d bits, alarm %d, %d%s", count, resolution, high, low, save ? ", saved" : "");
+    return result;
+}
+
+DS18B20_RESOLUTION ds18b20_read_resolution(DS18B20_Info * ds18b20_info)
+{
+    DS18B20_RESOLUTION resolution = DS18B20_RESOLUTION_INVALID;
+    if (_is_init(ds18b20_info))
+    {
+        // read scratchpad up to and including configuration register
+        Scratchpad scratchpad = {0};
+        ds18b20_info->config_valid = false;
+        if (_read_scratchpad(ds18b20_info, &scratchpad,
+                offsetof(Scratchpad, configuration) - offsetof(Scratchpad, temperature) + 1) == DS18B20_OK)
+        {
+            resolution = ((scratchpad.configuration >> 5) & 0x03) + DS18B20_RESOLUTION_9_BIT;
+            if (!_check_resolution(resolution))
+            {
+                ESP_LOGE(TAG, "invalid resolution read from device: 0x%02x", scratchpad.configuration);
+                resolution = DS18B20_RESOLUTION_INVALID;
+            }
+            else
+            {
+                ESP_LOGD(TAG, "Resolution read as %d", resolution);
+
+                // refresh the cached configuration
+                ds18b20_info->trigger_high = scratchpad.trigger_high;
+                ds18b20_info->trigger_low = scratchpad.trigger_low;
+                ds18b20_info->configuration = scratchpad.configuration;
+                ds18b20_info->config_valid = true;
+                ds18b20_info->config_unverified = false;
+            }
+        }
+        else
+        {
+            ESP_LOGE(TAG, "failed to read resolution from device");
+        }
+    }
+    return resolution;
+}
+
+bool ds18b20_convert(const DS18B20_Info * ds18b20_info)
+{
+    bool result = false;
+    if (_is_init(ds18b20_info) && _may_convert(ds18b20_info->bus, ds18b20_info->bus_lock))
+    {
+        const OneWireBus * bus = ds18b20_info->bus;
+        _lock_bus(ds18b20_info);
+        int64_t start_time = STATS_TIME();
+        if (_address_device(ds18b20_info))
+        {
+            // initiate a temperature measurement, powering parasitic devices until it is complete
+            owb_write_byte(bus, DS18B20_FUNCTION_TEMP_CONVERT);
+            owb_set_strong_pullup(bus, true);
+            _stats_bus_time(ds18b20_info, DS18B20_BUS_OP_CONVERT, start_time);
+            result = true;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "ds18b20 device not responding");
+        }
+        _unlock_bus(ds18b20_info);
+    }
+    return result;
+}
+
+void ds18b20_convert_all(const OneWireBus * bus)
+{
+    ds18b20_convert_all_locked(bus, NULL);
+}
+
+bool ds18b20_convert_all_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock)
+{
+    bool result = false;
+    if (bus == NULL)
+    {
+        ESP_LOGE(TAG, "bus is NULL");
+    }
+    else if (_may_convert(bus, bus_lock))
+    {
+        _take_lock(bus_lock);
+        int64_t start_time = STATS_TIME();
+        bool is_present = false;
+        owb_reset(bus, &is_present);
+        owb_write_byte(bus, OWB_ROM_SKIP);
+        owb_write_byte(bus, DS18B20_FUNCTION_TEMP_CONVERT);
+        owb_set_strong_pullup(bus, true);
+        _stats_broadcast_convert(is_present, start_time);
+        _give_lock(bus_lock);
+        result = true;
+    }
+    return result;
+}
+
+DS18B20_ERROR ds18b20_wait_for_conversion_us(const DS18B20_Info * ds18b20_info, uint32_t poll_interval_us, uint32_t * elapsed_us)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (_is_init(ds18b20_info))
+    {
+        err = _wait_precise(ds18b20_info, poll_interval_us ? poll_interval_us : DS18B20_DEFAULT_POLL_INTERVAL_US, elapsed_us,
+                            _can_poll(ds18b20_info));
+    }
+    return err;
+}
+
+static void _conversion_begin(DS18B20_Conversion * conversion, const OneWireBus * bus, int64_t conversion_time)
+{
+    if (conversion->timer != NULL)
+    {
+        // a notification for a previous conversion is no longer relevant
+        esp_timer_stop(conversion->timer);
+    }
+    conversion->bus = bus;
+    conversion->start_time = esp_timer_get_time();
+    conversion->deadline = conversion->start_time + conversion_time;
+    conversion->ready = false;
+    conversion->use_deadline = false;
+}
+
+static void _conversion_timer_callback(void * arg)
+{
+    DS18B20_Conversion * conversion = (DS18B20_Conversion *)arg;
+    _release_pullup(conversion->bus);
+    if (conversion->callback)
+    {
+        conversion->callback(conversion->context);
+    }
+    if (conversion->task)
+    {
+        xTaskNotifyGive(conversion->task);
+    }
+}
+
+DS18B20_ERROR ds18b20_convert_start(const DS18B20_Info * ds18b20_info, DS18B20_Conversion * conversion)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (conversion == NULL)
+    {
+        ESP_LOGE(TAG, "conversion is NULL");
+    }
+    else if (_is_init(ds18b20_info))
+    {
+        err = DS18B20_ERROR_DEVICE;
+        if (ds18b20_convert(ds18b20_info))
+        {
+            _conversion_begin(conversion, ds18b20_info->bus, _device_conversion_time_us(ds18b20_info));
+            conversion->use_deadline = !_can_poll(ds18b20_info);
+            err = DS18B20_OK;
+        }
+    }
+    return err;
+}
 
-        // read current resolution from device as it may not be power-on or factory default
-        ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+DS18B20_ERROR ds18b20_convert_all_start(const OneWireBus * bus, DS18B20_RESOLUTION resolution, DS18B20_Conversion * conversion)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (bus && conversion)
+    {
+        ds18b20_convert_all(bus);
+        _conversion_begin(conversion, bus, _conversion_time_us(resolution));
+        err = DS18B20_OK;
     }
     else
     {
-        ESP_LOGE(TAG, "ds18b20_info is NULL");
+        ESP_LOGE(TAG, "bus or conversion is NULL");
     }
+    return err;
 }
 
-void ds18b20_init_solo(DS18B20_Info * ds18b20_info, const OneWireBus * bus)
+bool ds18b20_conversion_poll(DS18B20_Conversion * conversion)
 {
-    if (ds18b20_info != NULL)
+    if (conversion && conversion->bus && !conversion->ready)
     {
-        _init(ds18b20_info, bus);
-        ds18b20_info->solo = true;
-        // ROM code not required
+        if (esp_timer_get_time() >= conversion->deadline)
+        {
+            _release_pullup(conversion->bus);
+            conversion->ready = true;
+        }
+        else if (!conversion->bus->use_parasitic_power && !conversion->use_deadline)
+        {
+            // all devices hold the bus low until their conversion is complete
+            uint8_t status = 0;
+            owb_read_bit(conversion->bus, &status);
+            conversion->ready = (status != 0);
+        }
+    }
+    return conversion && conversion->ready;
+}
 
-        // read current resolution from device as it may not be power-on or factory default
-        ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
+DS18B20_ERROR ds18b20_conversion_notify(DS18B20_Conversion * conversion, DS18B20_ConversionCallback callback, void * context, TaskHandle_t task)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (conversion && conversion->bus)
+    {
+        err = DS18B20_OK;
+        conversion->callback = callback;
+        conversion->context = context;
+        conversion->task = task;
+
+        if (conversion->timer == NULL)
+        {
+            const esp_timer_create_args_t args = {
+                .callback = _conversion_timer_callback,
+                .arg = conversion,
+                .name = "ds18b20",
+            };
+            if (esp_timer_create(&args, &conversion->timer) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "esp_timer_create failed");
+                conversion->timer = NULL;
+                err = DS18B20_ERROR_UNKNOWN;
+            }
+        }
+
+        if (err == DS18B20_OK)
+        {
+            int64_t remaining = conversion->deadline - esp_timer_get_time();
+            esp_timer_stop(conversion->timer);
+            esp_timer_start_once(conversion->timer, remaining > 0 ? remaining : 0);
+        }
     }
     else
     {
-        ESP_LOGE(TAG, "ds18b20_info is NULL");
+        ESP_LOGE(TAG, "conversion is NULL or not started");
     }
+    return err;
 }
 
-void ds18b20_use_crc(DS18B20_Info * ds18b20_info, bool use_crc)
+void ds18b20_conversion_release(DS18B20_Conversion * conversion)
 {
-    if (_is_init(ds18b20_info))
+    if (conversion && conversion->bus && !conversion->ready)
     {
-        ds18b20_info->use_crc = use_crc;
-        ESP_LOGD(TAG, "use_crc %d", ds18b20_info->use_crc);
+        // an abandoned conversion must not leave the bus held high
+        _release_pullup(conversion->bus);
+    }
+    if (conversion && conversion->timer)
+    {
+        esp_timer_stop(conversion->timer);
+        esp_timer_delete(conversion->timer);
+        conversion->timer = NULL;
     }
 }
 
-bool ds18b20_set_resolution(DS18B20_Info * ds18b20_info, DS18B20_RESOLUTION resolution)
+uint32_t ds18b20_wait_for_conversion(const DS18B20_Info * ds18b20_info)
 {
-    bool result = false;
+    uint32_t elapsed_time = 0;
     if (_is_init(ds18b20_info))
     {
-        if (_check_resolution(ds18b20_info->resolution))
+        if (!_can_poll(ds18b20_info))
         {
-            // read scratchpad up to and including configuration register
-            Scratchpad scratchpad = {0};
-            _read_scratchpad(ds18b20_info, &scratchpad,
-                    offsetof(Scratchpad, configuration) - offsetof(Scratchpad, temperature) + 1);
-
-            // modify configuration register to set resolution
-            uint8_t value = (((resolution - 1) & 0x03) << 5) | 0x1f;
-            scratchpad.configuration = value;
-            ESP_LOGD(TAG, "configuration value 0x%02x", value);
-
-            // write bytes 2, 3 and 4 of scratchpad
-            result = _write_scratchpad(ds18b20_info, &scratchpad, /* verify */ true);
-            if (result)
-            {
-                ds18b20_info->resolution = resolution;
-                ESP_LOGD(TAG, "Resolution set to %d bits", (int)resolution);
-            }
-            else
-            {
-                // Resolution change failed - update the info resolution with the value read from configuration
-                ds18b20_info->resolution = ds18b20_read_resolution(ds18b20_info);
-                ESP_LOGW(TAG, "Resolution consistency lost - refreshed from device: %d", ds18b20_info->resolution);
-            }
+            // in parasitic mode, devices cannot signal when they are complete,
+            // on a shared bus the signal may be lost, and in low-power mode it
+            // is not polled, so use the (calibrated) datasheet values to wait for a duration.
+            elapsed_time = _wait_for_duration(ds18b20_info);
         }
         else
         {
-            ESP_LOGE(TAG, "Unsupported resolution %d", resolution);
+            // wait for the device(s) to indicate the conversion is complete
+            elapsed_time = _wait_for_device_signal(ds18b20_info);
         }
+        _release_pullup(ds18b20_info->bus);
     }
-    return result;
+    return elapsed_time;
 }
 
-DS18B20_RESOLUTION ds18b20_read_resolution(DS18B20_Info * ds18b20_info)
+const DS18B20_Timing * ds18b20_get_timing(DS18B20_RESOLUTION resolution)
 {
-    DS18B20_RESOLUTION resolution = DS18B20_RESOLUTION_INVALID;
+    return _timing(resolution);
+}
+
+uint32_t ds18b20_get_conversion_time_us(const DS18B20_Info * ds18b20_info)
+{
+    uint32_t conversion_time = 0;
     if (_is_init(ds18b20_info))
     {
-        // read scratchpad up to and including configuration register
-        Scratchpad scratchpad = {0};
-        _read_scratchpad(ds18b20_info, &scratchpad,
-                offsetof(Scratchpad, configuration) - offsetof(Scratchpad, temperature) + 1);
+        conversion_time = (uint32_t)_device_conversion_time_us(ds18b20_info);
+    }
+    return conversion_time;
+}
+
+static DS18B20_ERROR _read_temp_raw(DS18B20_Info * ds18b20_info, int16_t * raw)
+{
+    // the read refreshes the cached device state, which other tasks sharing the bus may also update
+    _lock_bus(ds18b20_info);
+    Scratchpad scratchpad = {0};
+    DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
+    if (_use_checked_read(ds18b20_info))
+    {
+        err = _read_checked(ds18b20_info, &scratchpad);
+        HOT_LOGD(TAG, "checked read: %d", err);
+    }
+    else
+    {
+        err = _read_scratchpad(ds18b20_info, &scratchpad, _temp_read_count(ds18b20_info));
+    }
 
-        resolution = ((scratchpad.configuration >> 5) & 0x03) + DS18B20_RESOLUTION_9_BIT;
-        if (!_check_resolution(resolution))
+    *raw = DS18B20_RAW_INVALID;
+    if (err == DS18B20_OK)
+    {
+        _verify_restored_config(ds18b20_info, &scratchpad);
+        if (_detect_power_on(ds18b20_info, &scratchpad))
         {
-            ESP_LOGE(TAG, "invalid resolution read from device: 0x%02x", scratchpad.configuration);
-            resolution = DS18B20_RESOLUTION_INVALID;
+            ESP_LOGE(TAG, "Read power-on value (85.0)");
+            err = DS18B20_ERROR_DEVICE;
         }
         else
         {
-            ESP_LOGD(TAG, "Resolution read as %d", resolution);
+            *raw = _decode_raw(scratchpad.temperature[0], scratchpad.temperature[1], ds18b20_info->resolution);
         }
     }
-    return resolution;
+    _unlock_bus(ds18b20_info);
+    HOT_LOGD(TAG, "temp_LSB 0x%02x, temp_MSB 0x%02x, raw %d", scratchpad.temperature[0], scratchpad.temperature[1], *raw);
+    return err;
 }
 
-bool ds18b20_convert(const DS18B20_Info * ds18b20_info)
+DS18B20_ERROR ds18b20_read_temp(DS18B20_Info * ds18b20_info, float * value)
 {
-    bool result = false;
-    if (_is_init(ds18b20_info))
+    DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
+    if (HOT_IS_INIT(ds18b20_info))
     {
-        const OneWireBus * bus = ds18b20_info->bus;
-        if (_address_device(ds18b20_info))
+        int16_t raw = 0;
+        err = _read_temp_raw(ds18b20_info, &raw);
+        if (value)
         {
-            // initiate a temperature measurement
-            owb_write_byte(bus, DS18B20_FUNCTION_TEMP_CONVERT);
-            result = true;
+            *value = _raw_to_float(raw);
         }
-        else
+    }
+    return err;
+}
+
+DS18B20_ERROR ds18b20_read_temp_raw(DS18B20_Info * ds18b20_info, int16_t * value)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
+    if (HOT_IS_INIT(ds18b20_info))
+    {
+        int16_t raw = 0;
+        err = _read_temp_raw(ds18b20_info, &raw);
+        if (value)
         {
-            ESP_LOGE(TAG, "ds18b20 device not responding");
+            *value = raw;
         }
     }
-    return result;
+    return err;
 }
 
-void ds18b20_convert_all(const OneWireBus * bus)
+static DS18B20_ERROR _read_raw_fast(DS18B20_Info * ds18b20_info, int16_t * raw)
 {
-    if (bus)
+    // Batch read path - the caller has already validated ds18b20_info and raw.
+    // As for _read_temp_raw(), the cached device state is refreshed under the bus lock.
+    _lock_bus(ds18b20_info);
+    Scratchpad scratchpad = {0};
+    DS18B20_ERROR err = _use_checked_read(ds18b20_info)
+        ? _read_checked(ds18b20_info, &scratchpad)
+        : _transfer_scratchpad(ds18b20_info, &scratchpad, _scratchpad_count(ds18b20_info, _temp_read_count(ds18b20_info)), ds18b20_info->use_crc);
+    if (err == DS18B20_OK)
     {
-        bool is_present = false;
-        owb_reset(bus, &is_present);
-        owb_write_byte(bus, OWB_ROM_SKIP);
-        owb_write_byte(bus, DS18B20_FUNCTION_TEMP_CONVERT);
-        owb_set_strong_pullup(bus, true);
+        _verify_restored_config(ds18b20_info, &scratchpad);
+        if (_detect_power_on(ds18b20_info, &scratchpad))
+        {
+            err = DS18B20_ERROR_DEVICE;
+        }
+    }
+    // a partial or corrupted read may still hold a plausible value, so never report it
+    *raw = err == DS18B20_OK ? _decode_raw(scratchpad.temperature[0], scratchpad.temperature[1], ds18b20_info->resolution)
+                             : DS18B20_RAW_INVALID;
+    _unlock_bus(ds18b20_info);
+    return err;
+}
+
+static DS18B20_ERROR _read_temp_fast(DS18B20_Info * ds18b20_info, float * value)
+{
+    int16_t raw = 0;
+    DS18B20_ERROR err = _read_raw_fast(ds18b20_info, &raw);
+    *value = _raw_to_float(raw);
+    return err;
+}
+
+DS18B20_ERROR ds18b20_read_temp_trusted(DS18B20_Info * ds18b20_info, float * value)
+{
+    return _read_temp_fast(ds18b20_info, value);
+}
+
+DS18B20_ERROR ds18b20_read_temp_raw_trusted(DS18B20_Info * ds18b20_info, int16_t * value)
+{
+    return _read_raw_fast(ds18b20_info, value);
+}
+
+static void _read_into(DS18B20_Info * ds18b20_info, size_t index, float * out, int16_t * raw_out,
+                       DS18B20_ERROR * errs, DS18B20_ERROR * result)
+{
+    // read one device of a batch into either out or raw_out
+    int16_t raw = 0;
+    DS18B20_ERROR err = _read_raw_fast(ds18b20_info, &raw);
+    if (out)
+    {
+        out[index] = _raw_to_float(raw);
     }
     else
     {
-        ESP_LOGE(TAG, "bus is NULL");
+        raw_out[index] = raw;
     }
+    _collect(err, index, errs, result);
 }
 
-float ds18b20_wait_for_conversion(const DS18B20_Info * ds18b20_info)
+static DS18B20_ERROR _read_multi(DS18B20_Info * const devices[], size_t count,
+                                 float * out, int16_t * raw_out, DS18B20_ERROR * errs)
 {
-    float elapsed_time = 0.0f;
-    if (_is_init(ds18b20_info))
+    // Validate the whole set up-front so that the read loop itself is free of checks and logging.
+    if (!devices || (!out && !raw_out))
     {
-        if (ds18b20_info->bus->use_parasitic_power)
+        ESP_LOGE(TAG, "devices or out is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (!_all_init(devices, count))
+    {
+        return DS18B20_ERROR_NULL;
+    }
+
+    DS18B20_ERROR result = DS18B20_OK;
+    for (size_t i = 0; i < count; ++i)
+    {
+        _read_into(devices[i], i, out, raw_out, errs, &result);
+    }
+    return result;
+}
+
+DS18B20_ERROR ds18b20_read_temp_raw_multi(DS18B20_Info * const devices[], size_t count, int16_t * out, DS18B20_ERROR * errs)
+{
+    return _read_multi(devices, count, NULL, out, errs);
+}
+
+DS18B20_ERROR ds18b20_read_temp_multi(DS18B20_Info * const devices[], size_t count, float * out, DS18B20_ERROR * errs)
+{
+    return _read_multi(devices, count, out, NULL, errs);
+}
+
+static DS18B20_RESOLUTION _stage_resolution(const DS18B20_Info * ds18b20_info)
+{
+    // devices with an unknown resolution are read with the slowest devices
+    return _check_resolution(ds18b20_info->resolution) ? ds18b20_info->resolution : DS18B20_RESOLUTION_12_BIT;
+}
+
+DS18B20_ERROR ds18b20_read_temp_multi_staged(const DS18B20_Conversion * conversion,
+                                             DS18B20_Info * const devices[], size_t count,
+                                             float * out, DS18B20_ERROR * errs,
+                                             DS18B20_StageCallback callback, void * context)
+{
+    if (!conversion || !devices || !out)
+    {
+        ESP_LOGE(TAG, "conversion, devices or out is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (!_all_init(devices, count))
+    {
+        return DS18B20_ERROR_NULL;
+    }
+
+    if (count > 0 && devices[0]->bus->use_parasitic_power)
+    {
+        // Reading a device would interrupt power to those still converting, so wait
+        // for the slowest device and end the strong pullup before any stage is read.
+        int64_t deadline = 0;
+        for (size_t i = 0; i < count; ++i)
         {
-            // in parasitic mode, devices cannot signal when they are complete,
-            // so use the datasheet values to wait for a duration.
-            elapsed_time = _wait_for_duration(ds18b20_info->resolution);
+            int64_t device_deadline = conversion->start_time + _device_conversion_time_us(devices[i]);
+            if (device_deadline > deadline)
+            {
+                deadline = device_deadline;
+            }
         }
-        else
+        int64_t remaining = deadline - esp_timer_get_time();
+        if (remaining > 0)
         {
-            // wait for the device(s) to indicate the conversion is complete
-            elapsed_time = _wait_for_device_signal(ds18b20_info);
+            vTaskDelay(DS18B20_US_TO_TICKS(remaining));
         }
+        _release_pullup(devices[0]->bus);
     }
-    return elapsed_time;
+
+    DS18B20_ERROR result = DS18B20_OK;
+    for (DS18B20_RESOLUTION resolution = DS18B20_RESOLUTION_9_BIT; resolution <= DS18B20_RESOLUTION_12_BIT; ++resolution)
+    {
+        // the deadline for this stage is the longest conversion time of any device in it
+        int64_t deadline = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (_stage_resolution(devices[i]) == resolution)
+            {
+                int64_t device_deadline = conversion->start_time + _device_conversion_time_us(devices[i]);
+                if (device_deadline > deadline)
+                {
+                    deadline = device_deadline;
+                }
+            }
+        }
+
+        if (deadline > 0)
+        {
+            int64_t remaining = deadline - esp_timer_get_time();
+            if (remaining > 0)
+            {
+                vTaskDelay(DS18B20_US_TO_TICKS(remaining));
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (_stage_resolution(devices[i]) == resolution)
+                {
+                    _read_into(devices[i], i, out, NULL, errs, &result);
+                }
+            }
+
+            if (callback)
+            {
+                callback(resolution, context);
+            }
+        }
+    }
+    return result;
 }
 
-DS18B20_ERROR ds18b20_read_temp(const DS18B20_Info * ds18b20_info, float * value)
+DS18B20_ERROR ds18b20_pool_read_temp(DS18B20_Pool * pool, float * out, DS18B20_ERROR * errs)
 {
-    DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
-    if (_is_init(ds18b20_info))
+    if (!pool || !out)
     {
-        uint8_t temp_LSB = 0x00;
-        uint8_t temp_MSB = 0x80;
-        Scratchpad scratchpad = {0};
-        if ((err = _read_scratchpad(ds18b20_info, &scratchpad, 2)) == DS18B20_OK)
+        ESP_LOGE(TAG, "pool or out is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    for (size_t i = 0; i < pool->count; ++i)
+    {
+        if (!_is_init(&pool->devices[i]))
         {
-            temp_LSB = scratchpad.temperature[0];
-            temp_MSB = scratchpad.temperature[1];
+            return DS18B20_ERROR_NULL;
         }
+    }
+
+    DS18B20_ERROR result = DS18B20_OK;
+    for (size_t i = 0; i < pool->count; ++i)
+    {
+        _read_into(&pool->devices[i], i, out, NULL, errs, &result);
+    }
+    return result;
+}
+
+DS18B20_ERROR ds18b20_alarm_search(const OneWireBus * bus, OneWireBus_ROMCode * rom_codes, size_t max_count, size_t * count)
+{
+    return ds18b20_alarm_search_locked(bus, NULL, rom_codes, max_count, count);
+}
+
+DS18B20_ERROR ds18b20_alarm_search_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock,
+                                          OneWireBus_ROMCode * rom_codes, size_t max_count, size_t * count)
+{
+    if (!bus || !rom_codes || !count)
+    {
+        ESP_LOGE(TAG, "bus, rom_codes or count is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+
+    AlarmSearchState state = {0};
+    *count = 0;
+    while (*count < max_count && _alarm_search_locked(bus, bus_lock, &state))
+    {
+        rom_codes[(*count)++] = state.rom_code;
+    }
+    ESP_LOGD(TAG, "alarm search found %zu devices", *count);
+    return DS18B20_OK;
+}
+
+DS18B20_ERROR ds18b20_read_temp_alarmed(DS18B20_Info * const devices[], size_t count,
+                                        float * out, DS18B20_ERROR * errs, bool * alarmed)
+{
+    if (!devices || !out || !alarmed)
+    {
+        ESP_LOGE(TAG, "devices, out or alarmed is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (count == 0)
+    {
+        return DS18B20_OK;
+    }
+    if (!_all_init(devices, count))
+    {
+        return DS18B20_ERROR_NULL;
+    }
 
-        // https://github.com/cpetrich/counterfeit_DS18B20#solution-to-the-85-c-problem
-        if (scratchpad.reserved[1] == 0x0c && temp_MSB == 0x05 && temp_LSB == 0x50)
+    for (size_t i = 0; i < count; ++i)
+    {
+        alarmed[i] = false;
+        if (errs)
         {
-            ESP_LOGE(TAG, "Read power-on value (85.0)");
-            err = DS18B20_ERROR_DEVICE;
+            errs[i] = DS18B20_OK;
         }
+    }
 
-        float temp = _decode_temp(temp_LSB, temp_MSB, ds18b20_info->resolution);
-        ESP_LOGD(TAG, "temp_LSB 0x%02x, temp_MSB 0x%02x, temp %f", temp_LSB, temp_MSB, temp);
-
-        if (value)
+    // read each device found by the alarm search - there is no need to store the ROM codes
+    DS18B20_ERROR result = DS18B20_OK;
+    // each search pass is a complete bus transaction, so reads may be interleaved
+    AlarmSearchState state = {0};
+    while (_alarm_search_locked(devices[0]->bus, devices[0]->bus_lock, &state))
+    {
+        for (size_t i = 0; i < count; ++i)
         {
-            *value = temp;
+            if (!alarmed[i] && memcmp(devices[i]->rom_code.bytes, state.rom_code.bytes, sizeof(state.rom_code.bytes)) == 0)
+            {
+                alarmed[i] = true;
+                _read_into(devices[i], i, out, NULL, errs, &result);
+                break;
+            }
         }
     }
-    return err;
+    return result;
 }
 
-DS18B20_ERROR ds18b20_convert_and_read_temp(const DS18B20_Info * ds18b20_info, float * value)
+DS18B20_ERROR ds18b20_convert_and_read_temp(DS18B20_Info * ds18b20_info, float * value)
 {
     DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
     if (_is_init(ds18b20_info))
     {
+        // parasitically powered devices need the bus to themselves until the conversion is complete
+        bool hold = ds18b20_info->bus->use_parasitic_power;
+        if (hold)
+        {
+            _lock_bus(ds18b20_info);
+        }
+
         if (ds18b20_convert(ds18b20_info))
         {
             // wait at least maximum conversion time
@@ -573,30 +2501,43 @@ DS18B20_ERROR ds18b20_convert_and_read_temp(const DS18B20_Info * ds18b20_info, f
                 err = DS18B20_ERROR_NULL;
             }
         }
+
+        if (hold)
+        {
+            _unlock_bus(ds18b20_info);
+        }
     }
     return err;
 }
 
 DS18B20_ERROR ds18b20_check_for_parasite_power(const OneWireBus * bus, bool * present)
+{
+    return ds18b20_check_for_parasite_power_locked(bus, NULL, present);
+}
+
+DS18B20_ERROR ds18b20_check_for_parasite_power_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock, bool * present)
 {
     DS18B20_ERROR err = DS18B20_ERROR_UNKNOWN;
     ESP_LOGD(TAG, "ds18b20_check_for_parasite_power");
     if (bus) {
         bool reset_present;
-        if ((err = owb_reset(bus, &reset_present)) == DS18B20_OK)
+        _take_lock(bus_lock);
+        err = DS18B20_ERROR_OWB;
+        if (owb_reset(bus, &reset_present) == OWB_STATUS_OK)
         {
             ESP_LOGD(TAG, "owb_reset OK");
-            if ((err = owb_write_byte(bus, OWB_ROM_SKIP)) == DS18B20_OK)
+            if (owb_write_byte(bus, OWB_ROM_SKIP) == OWB_STATUS_OK)
             {
                 ESP_LOGD(TAG, "owb_write_byte(ROM_SKIP) OK");
-                if ((err = owb_write_byte(bus, DS18B20_FUNCTION_POWER_SUPPLY_READ)) == DS18B20_OK)
+                if (owb_write_byte(bus, DS18B20_FUNCTION_POWER_SUPPLY_READ) == OWB_STATUS_OK)
                 {
                     // Parasitic-powered devices will pull the bus low during read time slot
                     ESP_LOGD(TAG, "owb_write_byte(POWER_SUPPLY_READ) OK");
                     uint8_t value = 0;
-                    if ((err = owb_read_bit(bus, &value)) == DS18B20_OK)
+                    if (owb_read_bit(bus, &value) == OWB_STATUS_OK)
                     {
                         ESP_LOGD(TAG, "owb_read_bit OK: 0x%02x", value);
+                        err = DS18B20_OK;
                         if (present)
                         {
                             *present = !(bool)(value & 0x01u);
@@ -605,6 +2546,7 @@ DS18B20_ERROR ds18b20_check_for_parasite_power(const OneWireBus * bus, bool * pr
                 }
             }
         }
+        _give_lock(bus_lock);
     }
     else
     {
@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+
+#include "ds18b20_adaptive.h"
+
+static const char * TAG = "ds18b20_adaptive";
+
+static bool _is_near_threshold(const DS18B20_AdaptiveConfig * config, int16_t raw)
+{
+    return abs(raw - config->threshold_low) <= config->margin
+        || abs(raw - config->threshold_high) <= config->margin;
+}
+
+DS18B20_ERROR ds18b20_adaptive_init(DS18B20_Adaptive * adaptive, DS18B20_Info * ds18b20_info,
+                                    const DS18B20_AdaptiveConfig * config)
+{
+    if (!adaptive || !ds18b20_info || !config)
+    {
+        ESP_LOGE(TAG, "adaptive, ds18b20_info or config is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (config->min_resolution < DS18B20_RESOLUTION_9_BIT || config->max_resolution > DS18B20_RESOLUTION_12_BIT
+        || config->min_resolution > config->max_resolution)
+    {
+        ESP_LOGE(TAG, "invalid resolution range %d to %d", config->min_resolution, config->max_resolution);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    adaptive->ds18b20_info = ds18b20_info;
+    adaptive->config = *config;
+    adaptive->last_raw = 0;
+    adaptive->stable = 0;
+    adaptive->has_last = false;
+    return DS18B20_OK;
+}
+
+DS18B20_RESOLUTION ds18b20_adaptive_update(DS18B20_Adaptive * adaptive, int16_t raw)
+{
+    if (!adaptive || !adaptive->ds18b20_info)
+    {
+        ESP_LOGE(TAG, "adaptive is NULL or not initialised");
+        return DS18B20_RESOLUTION_INVALID;
+    }
+
+    const DS18B20_AdaptiveConfig * config = &adaptive->config;
+    DS18B20_Info * ds18b20_info = adaptive->ds18b20_info;
+    DS18B20_RESOLUTION current = ds18b20_info->resolution;
+    DS18B20_RESOLUTION resolution = current;
+    if (resolution < config->min_resolution || resolution > config->max_resolution)
+    {
+        // includes an unknown resolution
+        resolution = config->max_resolution;
+    }
+
+    // a change of a single step at the current resolution is never considered unstable,
+    // otherwise the lowest resolutions would immediately be raised again
+    int step = 1 << (DS18B20_RESOLUTION_12_BIT - resolution);
+    int stable_step = config->stable_step > step ? config->stable_step : step;
+    bool stable = adaptive->has_last && abs(raw - adaptive->last_raw) <= stable_step;
+    adaptive->stable = stable ? adaptive->stable + (adaptive->stable < UINT8_MAX) : 0;
+    adaptive->last_raw = raw;
+    adaptive->has_last = true;
+
+    if (_is_near_threshold(config, raw))
+    {
+        resolution = config->max_resolution;
+        adaptive->stable = 0;
+    }
+    else if (!stable)
+    {
+        if (resolution < config->max_resolution)
+        {
+            ++resolution;
+        }
+    }
+    else if (adaptive->stable >= config->stable_count)
+    {
+        if (resolution > config->min_resolution)
+        {
+            --resolution;
+        }
+        adaptive->stable = 0;
+    }
+
+    if (resolution != current)
+    {
+        if (ds18b20_set_resolution(ds18b20_info, resolution))
+        {
+            ESP_LOGD(TAG, "resolution %d -> %d bits at raw %d", current, resolution, raw);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "failed to set resolution to %d bits", resolution);
+        }
+    }
+    return ds18b20_info->resolution;
+}
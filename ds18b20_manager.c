@@ -0,0 +1,185 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_manager.c
+ *
+ * Each bus queue is a ring of power-of-two size indexed by free-running counters. The worker
+ * task is the only writer of head and the application the only writer of tail, so each side
+ * publishes its counter with release ordering after accessing the ring, and no lock is needed.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+
+#include "ds18b20_manager.h"
+
+static const char * TAG = "ds18b20_manager";
+
+/// @cond ignore
+typedef struct
+{
+    DS18B20_Sampler * sampler;
+    DS18B20_SampleEvent * events;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t overflows;
+} Bus;
+
+struct DS18B20_Manager
+{
+    Bus * buses;
+    size_t count;
+};
+/// @endcond ignore
+
+static uint32_t _queue_size(size_t length)
+{
+    uint32_t size = 1;
+    while (size < length)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+static void _push(const DS18B20_SampleEvent * event, void * context)
+{
+    // called by the bus worker task, the only producer
+    Bus * bus = (Bus *)context;
+    uint32_t head = bus->head;
+    if (head - __atomic_load_n(&bus->tail, __ATOMIC_ACQUIRE) > bus->mask)
+    {
+        __atomic_add_fetch(&bus->overflows, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        bus->events[head & bus->mask] = *event;
+        __atomic_store_n(&bus->head, head + 1, __ATOMIC_RELEASE);
+    }
+}
+
+DS18B20_Manager * ds18b20_manager_create(const DS18B20_ManagerBusConfig * buses, size_t count)
+{
+    if (!buses || count == 0)
+    {
+        ESP_LOGE(TAG, "buses is NULL or empty");
+        return NULL;
+    }
+
+    // a single allocation holds the manager, its buses and all of their queues
+    // with the queues aligned for the 64-bit timestamps of their events
+    size_t header_size = (sizeof(DS18B20_Manager) + count * sizeof(Bus) + _Alignof(DS18B20_SampleEvent) - 1)
+                       & ~(_Alignof(DS18B20_SampleEvent) - 1);
+    size_t size = header_size;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (buses[i].sampler.callback != NULL)
+        {
+            ESP_LOGE(TAG, "bus %zu: sampler callback is reserved for the manager", i);
+            return NULL;
+        }
+        size += _queue_size(buses[i].queue_length) * sizeof(DS18B20_SampleEvent);
+    }
+
+    DS18B20_Manager * manager = calloc(1, size);
+    if (manager == NULL)
+    {
+        ESP_LOGE(TAG, "malloc failed");
+        return NULL;
+    }
+
+    manager->buses = (Bus *)(manager + 1);
+    DS18B20_SampleEvent * events = (DS18B20_SampleEvent *)((uint8_t *)manager + header_size);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Bus * bus = &manager->buses[i];
+        uint32_t queue_size = _queue_size(buses[i].queue_length);
+        bus->events = events;
+        bus->mask = queue_size - 1;
+        events += queue_size;
+
+        DS18B20_SamplerConfig config = buses[i].sampler;
+        config.callback = _push;
+        config.context = bus;
+        bus->sampler = ds18b20_sampler_create(&config);
+        if (bus->sampler == NULL)
+        {
+            ESP_LOGE(TAG, "bus %zu: failed to create sampler", i);
+            ds18b20_manager_delete(&manager);
+            return NULL;
+        }
+        ++manager->count;
+    }
+
+    ESP_LOGD(TAG, "manager %p: %zu buses", manager, count);
+    return manager;
+}
+
+void ds18b20_manager_delete(DS18B20_Manager ** manager)
+{
+    if (manager != NULL && (*manager != NULL))
+    {
+        for (size_t i = 0; i < (*manager)->count; ++i)
+        {
+            ds18b20_sampler_delete(&(*manager)->buses[i].sampler);
+        }
+        ESP_LOGD(TAG, "delete %p", *manager);
+        free(*manager);
+        *manager = NULL;
+    }
+}
+
+bool ds18b20_manager_receive(DS18B20_Manager * manager, size_t bus, DS18B20_SampleEvent * event)
+{
+    bool received = false;
+    if (manager && event && bus < manager->count)
+    {
+        Bus * b = &manager->buses[bus];
+        uint32_t tail = b->tail;
+        if (tail != __atomic_load_n(&b->head, __ATOMIC_ACQUIRE))
+        {
+            *event = b->events[tail & b->mask];
+            __atomic_store_n(&b->tail, tail + 1, __ATOMIC_RELEASE);
+            received = true;
+        }
+    }
+    return received;
+}
+
+uint32_t ds18b20_manager_get_overflows(const DS18B20_Manager * manager, size_t bus)
+{
+    return (manager && bus < manager->count) ? __atomic_load_n(&manager->buses[bus].overflows, __ATOMIC_RELAXED) : 0;
+}
+
+DS18B20_Sampler * ds18b20_manager_get_sampler(const DS18B20_Manager * manager, size_t bus)
+{
+    return (manager && bus < manager->count) ? manager->buses[bus].sampler : NULL;
+}
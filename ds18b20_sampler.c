@@ -0,0 +1,371 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_sampler.c
+ *
+ * Each device's latest sample is protected by a sequence lock: the sampler task makes
+ * the sequence number odd before updating the sample and even afterwards, and readers
+ * retry until they observe the same even sequence number before and after their copy.
+ * Readers therefore never block the sampler task, and never see a partial update.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "ds18b20_sampler.h"
+
+static const char * TAG = "ds18b20_sampler";
+
+/// @cond ignore
+typedef struct
+{
+    uint32_t sequence;
+    DS18B20_Sample sample;
+} Slot;
+
+struct DS18B20_Sampler
+{
+    DS18B20_SamplerConfig config;
+    DS18B20_RESOLUTION resolution;
+    Slot * slots;
+    float * values;
+    DS18B20_ERROR * errors;
+    DS18B20_Subscription * subscriptions;
+    SemaphoreHandle_t subscriptions_lock;
+    SemaphoreHandle_t stopped;
+    TaskHandle_t task;
+    bool running;
+    uint32_t cycles;
+};
+/// @endcond ignore
+
+static void _free(DS18B20_Sampler * sampler)
+{
+    if (sampler->stopped)
+    {
+        vSemaphoreDelete(sampler->stopped);
+    }
+    if (sampler->subscriptions_lock)
+    {
+        vSemaphoreDelete(sampler->subscriptions_lock);
+    }
+    free(sampler);
+}
+
+static void _publish(Slot * slot, const DS18B20_Sample * sample)
+{
+    uint32_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->sample = *sample;
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+static bool _is_change(DS18B20_Subscription * subscription, const DS18B20_Sample * sample)
+{
+    bool change = false;
+    if (sample->error == DS18B20_OK)
+    {
+        float delta = sample->value - subscription->reference;
+        change = !subscription->has_reference || delta > subscription->deadband || delta < -subscription->deadband;
+        if (change)
+        {
+            subscription->reference = sample->value;
+            subscription->has_reference = true;
+        }
+    }
+    else if (subscription->has_reference)
+    {
+        // report the failure once, and the next valid sample regardless of its value
+        subscription->has_reference = false;
+        change = true;
+    }
+    return change;
+}
+
+static void _notify(DS18B20_Sampler * sampler, int64_t timestamp)
+{
+    if (sampler->config.callback)
+    {
+        for (size_t i = 0; i < sampler->config.count; ++i)
+        {
+            DS18B20_SampleEvent event = {
+                .index = i,
+                .sample = { .value = sampler->values[i], .error = sampler->errors[i], .timestamp = timestamp },
+            };
+            sampler->config.callback(&event, sampler->config.context);
+        }
+    }
+
+    xSemaphoreTake(sampler->subscriptions_lock, portMAX_DELAY);
+    for (DS18B20_Subscription * subscription = sampler->subscriptions; subscription; subscription = subscription->next)
+    {
+        size_t i = subscription->index;
+        DS18B20_SampleEvent event = {
+            .index = i,
+            .sample = { .value = sampler->values[i], .error = sampler->errors[i], .timestamp = timestamp },
+        };
+        if (_is_change(subscription, &event.sample))
+        {
+            if (subscription->callback)
+            {
+                subscription->callback(&event, subscription->context);
+            }
+            if (subscription->queue)
+            {
+                xQueueSend(subscription->queue, &event, 0);
+            }
+        }
+    }
+    xSemaphoreGive(sampler->subscriptions_lock);
+}
+
+static void _sample(DS18B20_Sampler * sampler)
+{
+    const DS18B20_SamplerConfig * config = &sampler->config;
+    DS18B20_Conversion conversion = {0};
+
+    // devices on a shared bus carry its lock, which is held throughout the cycle
+    // in parasitic power mode, and otherwise only for the broadcast and each read
+    SemaphoreHandle_t bus_lock = config->count ? config->devices[0]->bus_lock : NULL;
+    bool hold = config->bus->use_parasitic_power;
+    if (bus_lock)
+    {
+        xSemaphoreTakeRecursive(bus_lock, portMAX_DELAY);
+    }
+    DS18B20_ERROR err = ds18b20_convert_all_start(config->bus, sampler->resolution, &conversion);
+    if (bus_lock && !hold)
+    {
+        xSemaphoreGiveRecursive(bus_lock);
+    }
+
+    int64_t timestamp = 0;
+    if (err == DS18B20_OK)
+    {
+        ds18b20_read_temp_multi_staged(&conversion, config->devices, config->count,
+                                       sampler->values, sampler->errors, NULL, NULL);
+        timestamp = esp_timer_get_time();
+        for (size_t i = 0; i < config->count; ++i)
+        {
+            DS18B20_Sample sample = { .value = sampler->values[i], .error = sampler->errors[i], .timestamp = timestamp };
+            _publish(&sampler->slots[i], &sample);
+        }
+    }
+    ds18b20_conversion_release(&conversion);
+
+    if (bus_lock && hold)
+    {
+        xSemaphoreGiveRecursive(bus_lock);
+    }
+
+    // subscribers are notified once the bus has been released
+    if (err == DS18B20_OK)
+    {
+        _notify(sampler, timestamp);
+    }
+    __atomic_add_fetch(&sampler->cycles, 1, __ATOMIC_RELAXED);
+}
+
+static void _sampler_task(void * arg)
+{
+    DS18B20_Sampler * sampler = (DS18B20_Sampler *)arg;
+    TickType_t period = pdMS_TO_TICKS(sampler->config.period_ms);
+    if (period == 0)
+    {
+        period = 1;
+    }
+
+    TickType_t last_wake_time = xTaskGetTickCount();
+    while (__atomic_load_n(&sampler->running, __ATOMIC_ACQUIRE))
+    {
+        _sample(sampler);
+        vTaskDelayUntil(&last_wake_time, period);
+    }
+
+    // the sampler may be freed as soon as this is given
+    xSemaphoreGive(sampler->stopped);
+    vTaskDelete(NULL);
+}
+
+DS18B20_Sampler * ds18b20_sampler_create(const DS18B20_SamplerConfig * config)
+{
+    if (!config || !config->bus || (config->count && !config->devices))
+    {
+        ESP_LOGE(TAG, "config is NULL or incomplete");
+        return NULL;
+    }
+
+    DS18B20_RESOLUTION resolution = DS18B20_RESOLUTION_INVALID;
+    for (size_t i = 0; i < config->count; ++i)
+    {
+        if (!config->devices[i] || !config->devices[i]->init)
+        {
+            ESP_LOGE(TAG, "device %zu is not initialised", i);
+            return NULL;
+        }
+        if (config->devices[i]->resolution > resolution)
+        {
+            resolution = config->devices[i]->resolution;
+        }
+    }
+
+    // a single allocation holds the sampler and its per-device buffers, with the slots
+    // aligned for their 64-bit timestamps
+    size_t header_size = (sizeof(DS18B20_Sampler) + _Alignof(Slot) - 1) & ~(_Alignof(Slot) - 1);
+    size_t size = header_size + config->count * (sizeof(Slot) + sizeof(float) + sizeof(DS18B20_ERROR));
+    DS18B20_Sampler * sampler = calloc(1, size);
+    if (sampler == NULL)
+    {
+        ESP_LOGE(TAG, "malloc failed");
+        return NULL;
+    }
+
+    sampler->config = *config;
+    sampler->resolution = resolution;
+    sampler->slots = (Slot *)((uint8_t *)sampler + header_size);
+    sampler->values = (float *)(sampler->slots + config->count);
+    sampler->errors = (DS18B20_ERROR *)(sampler->values + config->count);
+    for (size_t i = 0; i < config->count; ++i)
+    {
+        sampler->slots[i].sample.error = DS18B20_ERROR_UNKNOWN;
+    }
+    sampler->subscriptions_lock = xSemaphoreCreateMutex();
+    sampler->stopped = xSemaphoreCreateBinary();
+    if (sampler->subscriptions_lock == NULL || sampler->stopped == NULL)
+    {
+        ESP_LOGE(TAG, "failed to create semaphores");
+        _free(sampler);
+        return NULL;
+    }
+    __atomic_store_n(&sampler->running, true, __ATOMIC_RELAXED);
+
+    uint32_t stack_size = config->stack_size ? config->stack_size : DS18B20_SAMPLER_DEFAULT_STACK_SIZE;
+    if (xTaskCreatePinnedToCore(_sampler_task, "ds18b20_sampler", stack_size, sampler,
+                                config->priority, &sampler->task, config->core_id) != pdPASS)
+    {
+        ESP_LOGE(TAG, "failed to create sampler task");
+        _free(sampler);
+        return NULL;
+    }
+
+    ESP_LOGD(TAG, "sampler %p: %zu devices, period %" PRIu32 " ms", sampler, config->count, config->period_ms);
+    return sampler;
+}
+
+void ds18b20_sampler_delete(DS18B20_Sampler ** sampler)
+{
+    if (sampler != NULL && (*sampler != NULL))
+    {
+        // ask the task to stop at the end of its current cycle, and wait for it: a dedicated
+        // semaphore, as the caller's task notifications may be in use for other purposes
+        __atomic_store_n(&(*sampler)->running, false, __ATOMIC_RELEASE);
+        xSemaphoreTake((*sampler)->stopped, portMAX_DELAY);
+
+        ESP_LOGD(TAG, "delete %p", *sampler);
+        _free(*sampler);
+        *sampler = NULL;
+    }
+}
+
+DS18B20_ERROR ds18b20_sampler_get(const DS18B20_Sampler * sampler, size_t index, DS18B20_Sample * sample)
+{
+    if (!sampler || !sample || index >= sampler->config.count)
+    {
+        ESP_LOGE(TAG, "invalid sampler, sample or index");
+        return DS18B20_ERROR_NULL;
+    }
+
+    const Slot * slot = &sampler->slots[index];
+    uint32_t before = 0;
+    uint32_t after = 0;
+    do
+    {
+        before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        *sample = slot->sample;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+    return DS18B20_OK;
+}
+
+uint32_t ds18b20_sampler_get_cycles(const DS18B20_Sampler * sampler)
+{
+    return sampler ? __atomic_load_n(&sampler->cycles, __ATOMIC_RELAXED) : 0;
+}
+
+DS18B20_ERROR ds18b20_sampler_subscribe(DS18B20_Sampler * sampler, DS18B20_Subscription * subscription,
+                                        size_t index, float deadband,
+                                        DS18B20_SubscriptionCallback callback, void * context, QueueHandle_t queue)
+{
+    if (!sampler || !subscription || index >= sampler->config.count)
+    {
+        ESP_LOGE(TAG, "invalid sampler, subscription or index");
+        return DS18B20_ERROR_NULL;
+    }
+
+    subscription->callback = callback;
+    subscription->context = context;
+    subscription->queue = queue;
+    subscription->index = index;
+    subscription->deadband = deadband;
+    subscription->reference = 0.0f;
+    subscription->has_reference = false;
+
+    xSemaphoreTake(sampler->subscriptions_lock, portMAX_DELAY);
+    subscription->next = sampler->subscriptions;
+    sampler->subscriptions = subscription;
+    xSemaphoreGive(sampler->subscriptions_lock);
+    return DS18B20_OK;
+}
+
+void ds18b20_sampler_unsubscribe(DS18B20_Sampler * sampler, DS18B20_Subscription * subscription)
+{
+    if (sampler && subscription)
+    {
+        xSemaphoreTake(sampler->subscriptions_lock, portMAX_DELAY);
+        DS18B20_Subscription ** link = &sampler->subscriptions;
+        while (*link && *link != subscription)
+        {
+            link = &(*link)->next;
+        }
+        if (*link)
+        {
+            *link = subscription->next;
+            subscription->next = NULL;
+        }
+        xSemaphoreGive(sampler->subscriptions_lock);
+    }
+}
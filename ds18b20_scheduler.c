@@ -0,0 +1,294 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_scheduler.c
+ *
+ * Each bus moves between two states: idle, where a conversion is started on the
+ * next step, and pending, where the conversion is polled until complete and the
+ * devices are then read. Because polling never blocks, conversions on all buses
+ * proceed concurrently while results from completed buses are being read.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "ds18b20_scheduler.h"
+
+static const char * TAG = "ds18b20_scheduler";
+
+static DS18B20_RESOLUTION _max_resolution(const DS18B20_SchedulerBus * bus)
+{
+    DS18B20_RESOLUTION resolution = DS18B20_RESOLUTION_INVALID;
+    for (size_t i = 0; i < bus->count; ++i)
+    {
+        if (bus->devices[i]->resolution > resolution)
+        {
+            resolution = bus->devices[i]->resolution;
+        }
+    }
+    return resolution;
+}
+
+static void _free_scratch(DS18B20_SchedulerBus * buses, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        free(buses[i].values);
+        free(buses[i].errs);
+        buses[i].values = NULL;
+        buses[i].errs = NULL;
+    }
+}
+
+static DS18B20_ERROR _read_bus(DS18B20_Scheduler * scheduler, DS18B20_SchedulerBus * bus)
+{
+    DS18B20_ERROR result = DS18B20_OK;
+    if (bus->count > 0)
+    {
+        // read the whole bus in one batch into the scratch storage, then publish,
+        // so that the snapshot is never held locked while the bus is in use
+        float * values = bus->values;
+        DS18B20_ERROR * errs = bus->errs;
+        for (size_t i = 0; i < bus->count; ++i)
+        {
+            // in case the batch is rejected before any device is read
+            values[i] = 0.0f;
+            errs[i] = DS18B20_ERROR_NULL;
+        }
+        result = ds18b20_read_temp_multi(bus->devices, bus->count, values, errs);
+        int64_t timestamp = esp_timer_get_time();
+
+        portENTER_CRITICAL(&scheduler->lock);
+        for (size_t i = 0; i < bus->count; ++i)
+        {
+            bus->samples[i] = (DS18B20_Sample){ .value = values[i], .error = errs[i], .timestamp = timestamp };
+        }
+        portEXIT_CRITICAL(&scheduler->lock);
+    }
+
+    portENTER_CRITICAL(&scheduler->lock);
+    bus->timestamp = esp_timer_get_time();
+    ++scheduler->sequence;
+    portEXIT_CRITICAL(&scheduler->lock);
+    return result;
+}
+
+static DS18B20_ERROR _start_bus(DS18B20_SchedulerBus * bus)
+{
+    // devices on a shared bus carry its lock, which also serialises the broadcast
+    SemaphoreHandle_t bus_lock = bus->count ? bus->devices[0]->bus_lock : NULL;
+    if (bus_lock)
+    {
+        xSemaphoreTakeRecursive(bus_lock, portMAX_DELAY);
+    }
+    // resolutions may have changed since the last conversion, e.g. by the adaptive controller,
+    // and the deadline must cover the slowest device
+    bus->resolution = _max_resolution(bus);
+    DS18B20_ERROR err = ds18b20_convert_all_start(bus->bus, bus->resolution, &bus->conversion);
+    if (bus_lock)
+    {
+        xSemaphoreGiveRecursive(bus_lock);
+        bus->conversion.use_deadline = true;
+    }
+    bus->pending = (err == DS18B20_OK);
+    return err;
+}
+
+static bool _poll_bus(DS18B20_Scheduler * scheduler, DS18B20_SchedulerBus * bus, DS18B20_ERROR * err)
+{
+    bool published = false;
+    if (bus->pending && ds18b20_conversion_poll(&bus->conversion))
+    {
+        *err = _read_bus(scheduler, bus);
+        bus->pending = false;
+        published = true;
+    }
+    return published;
+}
+
+DS18B20_ERROR ds18b20_scheduler_init(DS18B20_Scheduler * scheduler, DS18B20_SchedulerBus * buses, size_t count)
+{
+    if (!scheduler || !buses)
+    {
+        ESP_LOGE(TAG, "scheduler or buses is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        DS18B20_SchedulerBus * bus = &buses[i];
+        if (!bus->bus || !bus->samples || (bus->count && !bus->devices))
+        {
+            ESP_LOGE(TAG, "bus %zu is incomplete", i);
+            return DS18B20_ERROR_NULL;
+        }
+        for (size_t j = 0; j < bus->count; ++j)
+        {
+            if (!bus->devices[j] || !bus->devices[j]->init)
+            {
+                ESP_LOGE(TAG, "bus %zu device %zu is not initialised", i, j);
+                return DS18B20_ERROR_NULL;
+            }
+        }
+    }
+
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->buses = buses;
+    scheduler->count = count;
+    scheduler->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        DS18B20_SchedulerBus * bus = &buses[i];
+        bus->values = bus->count ? calloc(bus->count, sizeof(*bus->values)) : NULL;
+        bus->errs = bus->count ? calloc(bus->count, sizeof(*bus->errs)) : NULL;
+        if (bus->count && (bus->values == NULL || bus->errs == NULL))
+        {
+            ESP_LOGE(TAG, "bus %zu: malloc failed", i);
+            _free_scratch(buses, i + 1);
+            scheduler->count = 0;
+            return DS18B20_ERROR_UNKNOWN;
+        }
+        memset(&bus->conversion, 0, sizeof(bus->conversion));
+        bus->resolution = _max_resolution(bus);
+        bus->pending = false;
+        bus->timestamp = 0;
+        for (size_t j = 0; j < bus->count; ++j)
+        {
+            bus->samples[j] = (DS18B20_Sample){ .value = 0.0f, .error = DS18B20_ERROR_UNKNOWN, .timestamp = 0 };
+        }
+        ESP_LOGD(TAG, "bus %zu: %zu devices, resolution %d", i, bus->count, bus->resolution);
+    }
+    return DS18B20_OK;
+}
+
+void ds18b20_scheduler_deinit(DS18B20_Scheduler * scheduler)
+{
+    if (scheduler)
+    {
+        for (size_t i = 0; i < scheduler->count; ++i)
+        {
+            ds18b20_conversion_release(&scheduler->buses[i].conversion);
+        }
+        _free_scratch(scheduler->buses, scheduler->count);
+        scheduler->count = 0;
+    }
+}
+
+size_t ds18b20_scheduler_step(DS18B20_Scheduler * scheduler)
+{
+    size_t published = 0;
+    if (scheduler)
+    {
+        for (size_t i = 0; i < scheduler->count; ++i)
+        {
+            DS18B20_SchedulerBus * bus = &scheduler->buses[i];
+            DS18B20_ERROR err = DS18B20_OK;
+            if (!bus->pending)
+            {
+                _start_bus(bus);
+            }
+            else if (_poll_bus(scheduler, bus, &err))
+            {
+                ++published;
+            }
+        }
+    }
+    return published;
+}
+
+DS18B20_ERROR ds18b20_scheduler_run_cycle(DS18B20_Scheduler * scheduler)
+{
+    if (!scheduler)
+    {
+        ESP_LOGE(TAG, "scheduler is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+
+    // start a fresh conversion on every bus so that their conversion windows overlap,
+    // discarding any conversion left over from ds18b20_scheduler_step()
+    DS18B20_ERROR result = DS18B20_OK;
+    size_t remaining = 0;
+    for (size_t i = 0; i < scheduler->count; ++i)
+    {
+        DS18B20_ERROR err = _start_bus(&scheduler->buses[i]);
+        if (err == DS18B20_OK)
+        {
+            ++remaining;
+        }
+        else if (result == DS18B20_OK)
+        {
+            result = err;
+        }
+    }
+
+    // read each bus as soon as its own conversion completes
+    while (remaining > 0)
+    {
+        for (size_t i = 0; i < scheduler->count; ++i)
+        {
+            DS18B20_ERROR err = DS18B20_OK;
+            if (_poll_bus(scheduler, &scheduler->buses[i], &err))
+            {
+                --remaining;
+                if (result == DS18B20_OK)
+                {
+                    result = err;
+                }
+            }
+        }
+        if (remaining > 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    return result;
+}
+
+DS18B20_ERROR ds18b20_scheduler_get_sample(DS18B20_Scheduler * scheduler, size_t bus_index, size_t device_index, DS18B20_Sample * sample)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (scheduler && sample && bus_index < scheduler->count && device_index < scheduler->buses[bus_index].count)
+    {
+        portENTER_CRITICAL(&scheduler->lock);
+        *sample = scheduler->buses[bus_index].samples[device_index];
+        portEXIT_CRITICAL(&scheduler->lock);
+        err = DS18B20_OK;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "invalid scheduler, sample or index");
+    }
+    return err;
+}
@@ -0,0 +1,378 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_stream.c
+ *
+ * Block layout, all multi-byte values little-endian:
+ *
+ *   Header (6 bytes): sequence number of first frame (32-bit), frame count, channel count
+ *   Data:             nibbles, high nibble of each byte first, zero padded
+ *
+ * The data begins with one nibble per channel holding its delta shift, the number of low-order
+ * bits that are always zero at the channel's resolution (0 at 12-bit, 3 at 9-bit). Each reading
+ * is then encoded relative to the previous reading of the same channel in the block, starting
+ * from zero, so the first frame of a block is always a keyframe:
+ *
+ *   delta -7 to +7:   a single nibble holding the delta in units of the resolution LSB,
+ *                     that is, the raw difference shifted right by the delta shift,
+ *                     in two's complement
+ *   otherwise:        the escape nibble 0x8, followed by the 16-bit reading in four nibbles,
+ *                     most significant first
+ *
+ * A raw difference with any of the shifted-out bits set is escaped, so encoding is always lossless.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "ds18b20_stream.h"
+
+static const char * TAG = "ds18b20_stream";
+
+#define NIBBLE_ESCAPE      0x8
+#define DELTA_MAX          7
+#define ESCAPED_NIBBLES    5
+
+static size_t _capacity_nibbles(size_t block_size)
+{
+    return (block_size - DS18B20_STREAM_HEADER_SIZE) * 2;
+}
+
+static uint8_t * _block(const DS18B20_Stream * stream, size_t index)
+{
+    return stream->blocks + (index % stream->block_count) * stream->block_size;
+}
+
+static void _put_nibble(uint8_t * data, size_t index, uint8_t nibble)
+{
+    data[index / 2] |= (index & 1) ? nibble : (uint8_t)(nibble << 4);
+}
+
+static uint8_t _get_nibble(const uint8_t * data, size_t index)
+{
+    return (index & 1) ? (data[index / 2] & 0x0f) : (data[index / 2] >> 4);
+}
+
+static bool _encode_delta(const DS18B20_Stream * stream, size_t channel, int16_t raw, uint8_t * code)
+{
+    // the delta is exact only if none of the shifted-out bits are set
+    int step = 1 << stream->shifts[channel];
+    int delta = raw - stream->previous[channel];
+    bool small = (delta % step) == 0 && delta / step >= -DELTA_MAX && delta / step <= DELTA_MAX;
+    if (small)
+    {
+        *code = (delta / step) & 0x0f;
+    }
+    return small;
+}
+
+static size_t _frame_nibbles(const DS18B20_Stream * stream, const int16_t * raw)
+{
+    size_t nibbles = 0;
+    for (size_t i = 0; i < stream->channels; ++i)
+    {
+        uint8_t code = 0;
+        nibbles += _encode_delta(stream, i, raw[i], &code) ? 1 : ESCAPED_NIBBLES;
+    }
+    return nibbles;
+}
+
+static void _read_header(const uint8_t * block, DS18B20_StreamHeader * header)
+{
+    header->first_frame = block[0] | (block[1] << 8) | (block[2] << 16) | ((uint32_t)block[3] << 24);
+    header->frames = block[4];
+    header->channels = block[5];
+}
+
+static void _open_block(DS18B20_Stream * stream)
+{
+    if (stream->used == stream->block_count)
+    {
+        // the ring is full, so discard the oldest block
+        stream->head = (stream->head + 1) % stream->block_count;
+        --stream->used;
+        ++stream->dropped;
+    }
+
+    uint8_t * block = _block(stream, stream->head + stream->used);
+    memset(block, 0, stream->block_size);
+    block[0] = stream->sequence & 0xff;
+    block[1] = (stream->sequence >> 8) & 0xff;
+    block[2] = (stream->sequence >> 16) & 0xff;
+    block[3] = (stream->sequence >> 24) & 0xff;
+    block[5] = stream->channels;
+
+    uint8_t * data = block + DS18B20_STREAM_HEADER_SIZE;
+    for (size_t i = 0; i < stream->channels; ++i)
+    {
+        _put_nibble(data, i, stream->shifts[i]);
+    }
+
+    memset(stream->previous, 0, stream->channels * sizeof(*stream->previous));
+    stream->nibbles = stream->channels;
+    stream->open = true;
+}
+
+static void _close_block(DS18B20_Stream * stream)
+{
+    ++stream->used;
+    stream->open = false;
+}
+
+size_t ds18b20_stream_storage_size(size_t channels, size_t block_size, size_t block_count)
+{
+    return channels * (sizeof(int16_t) + sizeof(uint8_t)) + block_size * block_count;
+}
+
+DS18B20_ERROR ds18b20_stream_init(DS18B20_Stream * stream, void * storage, size_t channels,
+                                  size_t block_size, size_t block_count)
+{
+    if (!stream || !storage)
+    {
+        ESP_LOGE(TAG, "stream or storage is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (channels == 0 || channels > UINT8_MAX || block_count == 0
+        || block_size < DS18B20_STREAM_HEADER_SIZE
+        || _capacity_nibbles(block_size) < channels * (1 + ESCAPED_NIBBLES))
+    {
+        ESP_LOGE(TAG, "invalid geometry: %zu channels, %zu blocks of %zu bytes", channels, block_count, block_size);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+    stream->previous = storage;
+    stream->shifts = (uint8_t *)(stream->previous + channels);
+    stream->blocks = stream->shifts + channels;
+    memset(stream->shifts, 0, channels);
+    stream->block_size = block_size;
+    stream->block_count = block_count;
+    stream->channels = channels;
+    return DS18B20_OK;
+}
+
+DS18B20_ERROR ds18b20_stream_append(DS18B20_Stream * stream, const int16_t * raw)
+{
+    if (!stream || !stream->blocks || !raw)
+    {
+        ESP_LOGE(TAG, "stream or raw is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+
+    if (!stream->open)
+    {
+        _open_block(stream);
+    }
+
+    size_t nibbles = _frame_nibbles(stream, raw);
+    uint8_t * block = _block(stream, stream->head + stream->used);
+    if (stream->nibbles + nibbles > _capacity_nibbles(stream->block_size) || block[4] == UINT8_MAX)
+    {
+        // start a new block, which always has room for a keyframe
+        _close_block(stream);
+        _open_block(stream);
+        nibbles = _frame_nibbles(stream, raw);
+        block = _block(stream, stream->head + stream->used);
+    }
+
+    uint8_t * data = block + DS18B20_STREAM_HEADER_SIZE;
+    for (size_t i = 0; i < stream->channels; ++i)
+    {
+        uint8_t code = 0;
+        if (_encode_delta(stream, i, raw[i], &code))
+        {
+            _put_nibble(data, stream->nibbles++, code);
+        }
+        else
+        {
+            uint16_t value = (uint16_t)raw[i];
+            _put_nibble(data, stream->nibbles++, NIBBLE_ESCAPE);
+            for (int shift = 12; shift >= 0; shift -= 4)
+            {
+                _put_nibble(data, stream->nibbles++, (value >> shift) & 0x0f);
+            }
+        }
+        stream->previous[i] = raw[i];
+    }
+    ++block[4];
+    ++stream->sequence;
+    return DS18B20_OK;
+}
+
+DS18B20_ERROR ds18b20_stream_set_resolution(DS18B20_Stream * stream, size_t channel, DS18B20_RESOLUTION resolution)
+{
+    if (!stream || !stream->blocks || channel >= stream->channels)
+    {
+        ESP_LOGE(TAG, "invalid stream or channel");
+        return DS18B20_ERROR_NULL;
+    }
+
+    // an unknown resolution may use every bit
+    uint8_t shift = 0;
+    if (resolution >= DS18B20_RESOLUTION_9_BIT && resolution <= DS18B20_RESOLUTION_12_BIT)
+    {
+        shift = DS18B20_RESOLUTION_12_BIT - resolution;
+    }
+
+    if (shift != stream->shifts[channel])
+    {
+        // the shift is recorded in the block header, so it applies from the next block
+        ds18b20_stream_flush(stream);
+        stream->shifts[channel] = shift;
+    }
+    return DS18B20_OK;
+}
+
+void ds18b20_stream_flush(DS18B20_Stream * stream)
+{
+    if (stream && stream->open && _block(stream, stream->head + stream->used)[4] > 0)
+    {
+        _close_block(stream);
+    }
+}
+
+bool ds18b20_stream_peek(const DS18B20_Stream * stream, const uint8_t ** block, size_t * size,
+                         DS18B20_StreamHeader * header)
+{
+    bool available = false;
+    if (stream && block && size && stream->used > 0)
+    {
+        *block = _block(stream, stream->head);
+        *size = stream->block_size;
+        if (header)
+        {
+            _read_header(*block, header);
+        }
+        available = true;
+    }
+    return available;
+}
+
+bool ds18b20_stream_consume(DS18B20_Stream * stream, uint32_t first_frame)
+{
+    bool consumed = false;
+    if (stream && stream->used > 0)
+    {
+        // an append may have overwritten the peeked block since, and the oldest block is then another
+        DS18B20_StreamHeader header;
+        _read_header(_block(stream, stream->head), &header);
+        if (header.first_frame == first_frame)
+        {
+            stream->head = (stream->head + 1) % stream->block_count;
+            --stream->used;
+            consumed = true;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "block at frame %" PRIu32 " was overwritten before it was consumed", first_frame);
+        }
+    }
+    return consumed;
+}
+
+DS18B20_ERROR ds18b20_stream_decode(const uint8_t * block, size_t size, DS18B20_StreamHeader * header,
+                                    int16_t * raw, size_t capacity)
+{
+    if (!block || !raw)
+    {
+        ESP_LOGE(TAG, "block or raw is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (size < DS18B20_STREAM_HEADER_SIZE)
+    {
+        ESP_LOGE(TAG, "block is too small");
+        return DS18B20_ERROR_DEVICE;
+    }
+
+    uint8_t frames = block[4];
+    uint8_t channels = block[5];
+    if (header)
+    {
+        _read_header(block, header);
+    }
+    if ((size_t)frames * channels > capacity)
+    {
+        ESP_LOGE(TAG, "block has %d readings, only %zu provided", frames * channels, capacity);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    const uint8_t * data = block + DS18B20_STREAM_HEADER_SIZE;
+    size_t available = _capacity_nibbles(size);
+    if (available < channels)
+    {
+        ESP_LOGE(TAG, "block is truncated");
+        return DS18B20_ERROR_CRC;
+    }
+
+    uint8_t shifts[UINT8_MAX];
+    size_t nibble = 0;
+    for (size_t i = 0; i < channels; ++i)
+    {
+        shifts[i] = _get_nibble(data, nibble++);
+        if (shifts[i] > DS18B20_RESOLUTION_12_BIT - DS18B20_RESOLUTION_9_BIT)
+        {
+            ESP_LOGE(TAG, "channel %zu has invalid delta shift %d", i, shifts[i]);
+            return DS18B20_ERROR_CRC;
+        }
+    }
+
+    for (size_t i = 0; i < (size_t)frames * channels; ++i)
+    {
+        int16_t previous = i < channels ? 0 : raw[i - channels];
+        if (nibble >= available)
+        {
+            ESP_LOGE(TAG, "block is truncated");
+            return DS18B20_ERROR_CRC;
+        }
+
+        uint8_t code = _get_nibble(data, nibble++);
+        if (code == NIBBLE_ESCAPE)
+        {
+            if (nibble + ESCAPED_NIBBLES - 1 > available)
+            {
+                ESP_LOGE(TAG, "block is truncated");
+                return DS18B20_ERROR_CRC;
+            }
+            uint16_t value = 0;
+            for (int j = 0; j < ESCAPED_NIBBLES - 1; ++j)
+            {
+                value = (value << 4) | _get_nibble(data, nibble++);
+            }
+            raw[i] = (int16_t)value;
+        }
+        else
+        {
+            // sign-extend the 4-bit delta, and restore the units of 1/16 degree
+            int delta = (code & 0x08) ? (int)code - 16 : (int)code;
+            raw[i] = previous + delta * (1 << shifts[i % channels]);
+        }
+    }
+    return DS18B20_OK;
+}
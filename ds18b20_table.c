@@ -0,0 +1,247 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_table.c
+ *
+ * Serialised table layout, all multi-byte values little-endian:
+ *
+ *   Header (8 bytes): magic "DS18", version, flags, count (16-bit)
+ *   Entry (13 bytes): ROM code (8), resolution, flags, TH, TL, configuration
+ *   Footer (1 byte):  1-Wire CRC8 of all preceding bytes
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "ds18b20_table.h"
+#include "owb.h"
+
+static const char * TAG = "ds18b20_table";
+
+#define TABLE_MAGIC         "DS18"
+#define TABLE_VERSION       1
+#define TABLE_HEADER_SIZE   8
+#define TABLE_ENTRY_SIZE    13
+#define TABLE_FOOTER_SIZE   1
+
+#define TABLE_FLAG_PARASITIC_POWER  0x01
+
+#define ENTRY_FLAG_USE_CRC       0x01
+#define ENTRY_FLAG_SOLO          0x02
+#define ENTRY_FLAG_CONFIG_VALID  0x04
+
+size_t ds18b20_table_size(size_t count)
+{
+    return TABLE_HEADER_SIZE + count * TABLE_ENTRY_SIZE + TABLE_FOOTER_SIZE;
+}
+
+DS18B20_ERROR ds18b20_table_save(const DS18B20_Info * const devices[], size_t count, bool parasitic_power,
+                                 void * buffer, size_t * size)
+{
+    if (!devices || !buffer || !size)
+    {
+        ESP_LOGE(TAG, "devices, buffer or size is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+    if (count > UINT16_MAX || *size < ds18b20_table_size(count))
+    {
+        ESP_LOGE(TAG, "buffer too small for %zu devices", count);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    uint8_t * p = buffer;
+    memcpy(p, TABLE_MAGIC, 4);
+    p[4] = TABLE_VERSION;
+    p[5] = parasitic_power ? TABLE_FLAG_PARASITIC_POWER : 0;
+    p[6] = count & 0xff;
+    p[7] = (count >> 8) & 0xff;
+    p += TABLE_HEADER_SIZE;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DS18B20_Info * ds18b20_info = devices[i];
+        if (!ds18b20_info || !ds18b20_info->init)
+        {
+            ESP_LOGE(TAG, "device %zu is not initialised", i);
+            return DS18B20_ERROR_NULL;
+        }
+        memcpy(p, ds18b20_info->rom_code.bytes, 8);
+        p[8] = (uint8_t)ds18b20_info->resolution;
+        p[9] = (ds18b20_info->use_crc ? ENTRY_FLAG_USE_CRC : 0)
+             | (ds18b20_info->solo ? ENTRY_FLAG_SOLO : 0)
+             | (ds18b20_info->config_valid ? ENTRY_FLAG_CONFIG_VALID : 0);
+        p[10] = ds18b20_info->trigger_high;
+        p[11] = ds18b20_info->trigger_low;
+        p[12] = ds18b20_info->configuration;
+        p += TABLE_ENTRY_SIZE;
+    }
+
+    *p = owb_crc8_bytes(0, buffer, p - (uint8_t *)buffer);
+    *size = ds18b20_table_size(count);
+    ESP_LOGD(TAG, "saved %zu devices, %zu bytes", count, *size);
+    return DS18B20_OK;
+}
+
+DS18B20_ERROR ds18b20_table_restore(DS18B20_Info * const devices[], size_t max_count, const OneWireBus * bus,
+                                    const void * buffer, size_t size, size_t * count, bool * parasitic_power)
+{
+    if (!devices || !bus || !buffer || !count)
+    {
+        ESP_LOGE(TAG, "devices, bus, buffer or count is NULL");
+        return DS18B20_ERROR_NULL;
+    }
+
+    const uint8_t * p = buffer;
+    *count = 0;
+    if (size < ds18b20_table_size(0) || memcmp(p, TABLE_MAGIC, 4) != 0 || p[4] != TABLE_VERSION)
+    {
+        ESP_LOGE(TAG, "not a device table");
+        return DS18B20_ERROR_DEVICE;
+    }
+
+    size_t entries = p[6] | (p[7] << 8);
+    if (size != ds18b20_table_size(entries) || owb_crc8_bytes(0, p, size) != 0)
+    {
+        ESP_LOGE(TAG, "device table is corrupt");
+        return DS18B20_ERROR_CRC;
+    }
+    if (entries > max_count)
+    {
+        ESP_LOGE(TAG, "table has %zu devices, only %zu provided", entries, max_count);
+        return DS18B20_ERROR_UNKNOWN;
+    }
+
+    if (parasitic_power)
+    {
+        *parasitic_power = (p[5] & TABLE_FLAG_PARASITIC_POWER) != 0;
+    }
+    p += TABLE_HEADER_SIZE;
+
+    for (size_t i = 0; i < entries; ++i)
+    {
+        DS18B20_Info * ds18b20_info = devices[i];
+        if (!ds18b20_info)
+        {
+            ESP_LOGE(TAG, "device %zu is NULL", i);
+            return DS18B20_ERROR_NULL;
+        }
+
+        OneWireBus_ROMCode rom_code;
+        memcpy(rom_code.bytes, p, 8);
+        ds18b20_init_with_resolution(ds18b20_info, bus, rom_code, (DS18B20_RESOLUTION)p[8]);
+        ds18b20_info->use_crc = (p[9] & ENTRY_FLAG_USE_CRC) != 0;
+        ds18b20_info->solo = (p[9] & ENTRY_FLAG_SOLO) != 0;
+        ds18b20_info->config_valid = (p[9] & ENTRY_FLAG_CONFIG_VALID) != 0;
+        ds18b20_info->trigger_high = p[10];
+        ds18b20_info->trigger_low = p[11];
+        ds18b20_info->configuration = p[12];
+
+        // confirm against the device on the first read
+        ds18b20_info->config_unverified = true;
+        p += TABLE_ENTRY_SIZE;
+    }
+
+    *count = entries;
+    ESP_LOGD(TAG, "restored %zu devices", entries);
+    return DS18B20_OK;
+}
+
+DS18B20_ERROR ds18b20_table_save_nvs(nvs_handle_t handle, const char * key,
+                                     const DS18B20_Info * const devices[], size_t count, bool parasitic_power)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (key)
+    {
+        size_t size = ds18b20_table_size(count);
+        uint8_t * buffer = malloc(size);
+        if (buffer != NULL)
+        {
+            if ((err = ds18b20_table_save(devices, count, parasitic_power, buffer, &size)) == DS18B20_OK)
+            {
+                if (nvs_set_blob(handle, key, buffer, size) != ESP_OK || nvs_commit(handle) != ESP_OK)
+                {
+                    ESP_LOGE(TAG, "failed to write NVS key %s", key);
+                    err = DS18B20_ERROR_UNKNOWN;
+                }
+            }
+            free(buffer);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "malloc failed");
+            err = DS18B20_ERROR_UNKNOWN;
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "key is NULL");
+    }
+    return err;
+}
+
+DS18B20_ERROR ds18b20_table_restore_nvs(nvs_handle_t handle, const char * key,
+                                        DS18B20_Info * const devices[], size_t max_count, const OneWireBus * bus,
+                                        size_t * count, bool * parasitic_power)
+{
+    DS18B20_ERROR err = DS18B20_ERROR_NULL;
+    if (key)
+    {
+        size_t size = 0;
+        if (nvs_get_blob(handle, key, NULL, &size) == ESP_OK && size > 0)
+        {
+            uint8_t * buffer = malloc(size);
+            if (buffer != NULL)
+            {
+                err = DS18B20_ERROR_UNKNOWN;
+                if (nvs_get_blob(handle, key, buffer, &size) == ESP_OK)
+                {
+                    err = ds18b20_table_restore(devices, max_count, bus, buffer, size, count, parasitic_power);
+                }
+                free(buffer);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "malloc failed");
+                err = DS18B20_ERROR_UNKNOWN;
+            }
+        }
+        else
+        {
+            ESP_LOGD(TAG, "NVS key %s not found", key);
+            err = DS18B20_ERROR_DEVICE;
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "key is NULL");
+    }
+    return err;
+}
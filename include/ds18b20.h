@@ -34,12 +34,45 @@
 #ifndef DS18B20_H
 #define DS18B20_H
 
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "owb.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define DS18B20_FAMILY_CODE 0x28  ///< ROM code family of DS18B20 devices
+#define DS18B20_RAW_INVALID ((int16_t)0x8000)  ///< Raw value reported by a failed read, -2048.0 degrees Celsius, outside the measurement range
+
+#define DS18B20_DEFAULT_POLL_INTERVAL_US 1000  ///< Default bus poll interval for ds18b20_wait_for_conversion_us()
+#define DS18B20_STATS_HISTOGRAM_BUCKETS 9       ///< Number of buckets in the conversion time histogram
+
+#ifdef CONFIG_DS18B20_CALIBRATION_GUARD_PERCENT
+#  define DS18B20_CALIBRATION_GUARD_PERCENT CONFIG_DS18B20_CALIBRATION_GUARD_PERCENT
+#else
+#  define DS18B20_CALIBRATION_GUARD_PERCENT 5   ///< Margin added to a calibrated conversion time, in percent
+#endif
+
+#ifdef CONFIG_DS18B20_CONVERSION_OVERTIME_PERCENT
+#  define DS18B20_CONVERSION_OVERTIME_PERCENT CONFIG_DS18B20_CONVERSION_OVERTIME_PERCENT
+#else
+#  define DS18B20_CONVERSION_OVERTIME_PERCENT 10  ///< Time beyond the datasheet maximum allowed for a device to signal completion, in percent
+#endif
+
+/// Maximum conversion time from the datasheet for a valid resolution, in microseconds
+#define DS18B20_CONVERSION_TIME_US(resolution) (750000UL >> (12 - (resolution)))
+
+/// Time allowed for a device to signal completion of a conversion at a valid resolution, in microseconds
+#define DS18B20_CONVERSION_TIMEOUT_US(resolution) \
+    (DS18B20_CONVERSION_TIME_US(resolution) * (100 + DS18B20_CONVERSION_OVERTIME_PERCENT) / 100)
+
+/// Convert a duration in microseconds to RTOS ticks, rounding up
+#define DS18B20_US_TO_TICKS(us) ((TickType_t)(((us) + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000)))
+
 /**
  * @brief Success and error codes.
  */
@@ -51,6 +84,7 @@ typedef enum
     DS18B20_ERROR_CRC,     ///< A CRC error occurred
     DS18B20_ERROR_OWB,     ///< A One Wire Bus error occurred
     DS18B20_ERROR_NULL,    ///< A parameter or value is NULL
+    DS18B20_ERROR_ARGUMENT,  ///< A parameter is inconsistent with the others
 } DS18B20_ERROR;
 
 /**
@@ -65,20 +99,155 @@ typedef enum
     DS18B20_RESOLUTION_12_BIT  = 12,  ///< 12-bit resolution (default)
 } DS18B20_RESOLUTION;
 
+/**
+ * @brief Enumeration of bus transactions whose duration is accounted for in DS18B20_Stats.
+ */
+typedef enum
+{
+    DS18B20_BUS_OP_CONVERT = 0,       ///< Convert T command, addressed to a single device or to all devices
+    DS18B20_BUS_OP_SCRATCHPAD_READ,   ///< Scratchpad read, including resolution and configuration reads
+    DS18B20_BUS_OP_SCRATCHPAD_WRITE,  ///< Scratchpad write of alarm triggers and configuration
+    DS18B20_BUS_OP_EEPROM_COPY,       ///< Copy of the scratchpad to EEPROM, including the write time
+    DS18B20_BUS_OP_MAX,               ///< Number of bus transaction types
+} DS18B20_BUS_OP;
+
+/**
+ * @brief Structure containing the bus time accounted to one type of transaction.
+ */
+typedef struct
+{
+    uint32_t count;                         ///< Number of transactions
+    uint32_t max_us;                        ///< Longest transaction, in microseconds
+    uint64_t total_us;                      ///< Total duration of all transactions, in microseconds
+} DS18B20_BusTime;
+
+/**
+ * @brief Structure containing performance and error counters.
+ *
+ * A single instance may be shared by all devices on a bus to obtain per-bus counters.
+ * Counters are updated without locking, so a shared instance should only be used by
+ * devices that are accessed from the same task. Requires CONFIG_DS18B20_ENABLE_STATS.
+ */
+typedef struct
+{
+    uint32_t conversions;                   ///< Number of conversion times measured
+    uint32_t conversion_histogram[DS18B20_STATS_HISTOGRAM_BUCKETS]; ///< Bucket i counts conversions lasting i/8 to (i+1)/8 of the datasheet maximum, the last bucket counts longer conversions
+    uint32_t conversion_timeouts;           ///< Number of conversions not signalled complete within the allowed time
+    DS18B20_BusTime bus_time[DS18B20_BUS_OP_MAX]; ///< Time spent on the bus, by type of transaction
+    uint32_t resets;                        ///< Number of bus resets issued
+    uint32_t crc_failures;                  ///< Number of scratchpad reads that failed the CRC check
+    uint32_t power_on_values;               ///< Number of reads that returned the power-on value (85 degrees Celsius)
+    uint32_t not_present;                   ///< Number of times the device did not respond to a reset
+    uint32_t retries;                       ///< Number of scratchpad reads repeated to recover from an error or anomaly
+} DS18B20_Stats;
+
+/**
+ * @brief Structure containing the conversion timing for one resolution.
+ */
+typedef struct
+{
+    uint32_t conversion_us;        ///< Maximum conversion time from the datasheet, in microseconds
+    uint32_t timeout_us;           ///< Time allowed for a device to signal completion, in microseconds
+    TickType_t conversion_ticks;   ///< Maximum conversion time, in RTOS ticks, rounded up
+    TickType_t timeout_ticks;      ///< Time allowed for a device to signal completion, in RTOS ticks, rounded up
+} DS18B20_Timing;
+
 /**
  * @brief Structure containing information related to a single DS18B20 device connected
  * via a 1-Wire bus.
+ *
+ * Members are ordered by size and boolean settings are packed into single bits,
+ * to keep arrays of many instances compact. The cached device state is updated by reads,
+ * under the bus lock, so its flags are kept out of the settings bits, where an update
+ * could otherwise be lost to a concurrent change of a neighbouring setting.
  */
 typedef struct
 {
-    bool init;                     ///< True if struct has been initialised, otherwise false
-    bool solo;                     ///< True if device is intended to be the only one connected to the bus, otherwise false
-    bool use_crc;                  ///< True if CRC checks are to be used when retrieving information from a device on the bus
     const OneWireBus * bus;        ///< Pointer to 1-Wire bus information relevant to this device
+    SemaphoreHandle_t bus_lock;    ///< Optional recursive mutex serialising transactions on a shared bus, or NULL
+#ifdef CONFIG_DS18B20_ENABLE_STATS
+    DS18B20_Stats * stats;         ///< Optional pointer to counters updated by operations on this device
+#endif
     OneWireBus_ROMCode rom_code;   ///< The ROM code used to address this device on the bus
     DS18B20_RESOLUTION resolution; ///< Temperature measurement resolution per reading
+    uint32_t calibrated_conversion_us; ///< Longest measured conversion time, scaled to 12-bit resolution, in microseconds, or 0
+    int16_t last_raw;              ///< Last accepted measurement, in 1/16 degrees Celsius, used by the plausibility check
+    uint16_t max_step;             ///< Largest plausible change between measurements, in 1/16 degrees Celsius, or 0 for no limit
+    uint16_t retry_backoff_us;     ///< Delay before the first retry of a failed scratchpad read, doubled for each subsequent retry up to 128 times
+    uint8_t trigger_high;          ///< Cached high alarm trigger register (TH)
+    uint8_t trigger_low;           ///< Cached low alarm trigger register (TL)
+    uint8_t configuration;         ///< Cached configuration register
+    uint8_t crc_interval;          ///< With the plausibility check, perform a full CRC-checked read every this many reads, or 0
+    uint8_t crc_count;             ///< Number of reads since the last periodic CRC-checked read
+    uint8_t crc_retries;           ///< Number of times a scratchpad read is retried after a CRC or bus error
+    uint8_t presence_retries;      ///< Number of times a scratchpad read is retried when the device does not respond
+    bool config_valid;             ///< True if trigger_high, trigger_low and configuration match the device scratchpad
+    bool config_unverified;        ///< True if the cached configuration was restored and not yet confirmed by the device
+    bool last_valid;               ///< True if last_raw holds an accepted measurement
+    bool init : 1;                 ///< True if struct has been initialised, otherwise false
+    bool solo : 1;                 ///< True if device is intended to be the only one connected to the bus, otherwise false
+    bool use_crc : 1;              ///< True if CRC checks are to be used when retrieving information from a device on the bus
+    bool use_calibration : 1;      ///< True if the calibrated conversion time is to be used instead of the datasheet value
+    bool use_plausibility_check : 1; ///< True if temperature reads without CRC are checked for plausibility
+    bool use_low_power_wait : 1;   ///< True if conversion waits sleep until the deadline rather than polling
+    bool use_power_on_recovery : 1; ///< True if a power-on value read from the device triggers recovery
 } DS18B20_Info;
 
+/**
+ * @brief Callback invoked when an asynchronous temperature conversion is due to be complete.
+ * @param[in] context Context pointer provided to ds18b20_conversion_notify().
+ */
+typedef void (*DS18B20_ConversionCallback)(void * context);
+
+/**
+ * @brief Callback invoked when all devices of one resolution have been read by ds18b20_read_temp_multi_staged().
+ * @param[in] resolution Resolution of the devices that have just been read.
+ * @param[in] context Context pointer provided to ds18b20_read_temp_multi_staged().
+ */
+typedef void (*DS18B20_StageCallback)(DS18B20_RESOLUTION resolution, void * context);
+
+/**
+ * @brief Structure containing the state of an asynchronous temperature conversion.
+ *
+ * Must be zero-initialised before first use, and released with ds18b20_conversion_release()
+ * once no longer required. The same instance may be reused for successive conversions.
+ */
+typedef struct
+{
+    const OneWireBus * bus;               ///< Pointer to 1-Wire bus on which the conversion was started
+    int64_t start_time;                   ///< Time at which the conversion was started, in microseconds
+    int64_t deadline;                     ///< Time by which the conversion is guaranteed to be complete, in microseconds
+    bool ready;                           ///< True once the conversion has been detected as complete
+    bool use_deadline;                    ///< True if completion is determined by the deadline alone, without polling the bus
+    DS18B20_ConversionCallback callback;  ///< Optional callback invoked on completion
+    void * context;                       ///< Context pointer passed to callback
+    TaskHandle_t task;                    ///< Optional task to notify (xTaskNotifyGive) on completion
+    esp_timer_handle_t timer;             ///< Timer used to deliver the completion notification
+} DS18B20_Conversion;
+
+/**
+ * @brief Structure containing a single timestamped temperature measurement.
+ */
+typedef struct
+{
+    float value;          ///< Measurement value, in degrees Celsius
+    DS18B20_ERROR error;  ///< Result of the read that produced this value
+    int64_t timestamp;    ///< Time at which the value was read, in microseconds since boot
+} DS18B20_Sample;
+
+/**
+ * @brief Structure containing a contiguous array of device info instances.
+ *
+ * Slots are handed out in order by ds18b20_pool_alloc() and are never returned individually.
+ */
+typedef struct
+{
+    DS18B20_Info * devices;  ///< Contiguous array of device info slots
+    size_t capacity;         ///< Number of slots in devices
+    size_t count;            ///< Number of slots handed out so far
+    bool owned;              ///< True if the pool and its slots were allocated by ds18b20_pool_create()
+} DS18B20_Pool;
+
 /**
  * @brief Construct a new device info instance.
  *        New instance should be initialised before calling other functions.
@@ -93,6 +262,87 @@ DS18B20_Info * ds18b20_malloc(void);
  */
 void ds18b20_free(DS18B20_Info ** ds18b20_info);
 
+/**
+ * @brief Initialise a pool of device info instances using caller-supplied storage.
+ *
+ * Pools initialised this way must not be passed to ds18b20_pool_free().
+ * @param[in] pool Pointer to pool instance.
+ * @param[in] storage Array of at least capacity device info instances, for example a static array.
+ * @param[in] capacity Number of entries in storage.
+ */
+void ds18b20_pool_init(DS18B20_Pool * pool, DS18B20_Info * storage, size_t capacity);
+
+/**
+ * @brief Construct a new pool of device info instances in a single allocation.
+ * @param[in] capacity Number of device info slots.
+ * @return Pointer to new pool, or NULL if it cannot be created.
+ */
+DS18B20_Pool * ds18b20_pool_create(size_t capacity);
+
+/**
+ * @brief Construct a new pool of device info instances in a single allocation with specific capabilities.
+ * @param[in] capacity Number of device info slots.
+ * @param[in] caps Bitwise OR of MALLOC_CAP_* flags, for example MALLOC_CAP_SPIRAM or MALLOC_CAP_INTERNAL.
+ * @return Pointer to new pool, or NULL if it cannot be created.
+ */
+DS18B20_Pool * ds18b20_pool_create_with_caps(size_t capacity, uint32_t caps);
+
+/**
+ * @brief Delete a pool created by ds18b20_pool_create(), including all of its slots.
+ * @param[in,out] pool Pointer to pool pointer that will be freed and set to NULL.
+ */
+void ds18b20_pool_free(DS18B20_Pool ** pool);
+
+/**
+ * @brief Take the next unused device info slot from a pool.
+ *        The slot should be initialised before calling other functions.
+ * @param[in] pool Pointer to pool instance.
+ * @return Pointer to device info slot, or NULL if the pool is exhausted.
+ */
+DS18B20_Info * ds18b20_pool_alloc(DS18B20_Pool * pool);
+
+/**
+ * @brief Sort the allocated slots of a pool into ascending ROM code order, for use with ds18b20_pool_find().
+ *
+ * Any pointers to individual slots held by the caller are invalidated.
+ * @param[in] pool Pointer to pool instance.
+ */
+void ds18b20_pool_sort(DS18B20_Pool * pool);
+
+/**
+ * @brief Find the device with a specific ROM code in a sorted pool, by binary search.
+ * @param[in] pool Pointer to pool instance, sorted by ds18b20_pool_sort() or ds18b20_discover().
+ * @param[in] rom_code ROM code of the device to find.
+ * @return Pointer to device info slot, or NULL if the device is not in the pool.
+ */
+DS18B20_Info * ds18b20_pool_find(const DS18B20_Pool * pool, OneWireBus_ROMCode rom_code);
+
+/**
+ * @brief Search a bus for DS18B20 devices and initialise a pool slot for each one found.
+ *
+ * Devices from other families are ignored. Any slots previously allocated from the pool are
+ * discarded. The slots are sorted by ROM code, so the same set of devices is always assigned the
+ * same slots, and ds18b20_pool_find() can be used to look up a device by ROM code.
+ * Each device's resolution is read once, by ds18b20_init().
+ * @param[in] bus Pointer to initialised 1-Wire bus instance.
+ * @param[in] pool Pointer to pool instance.
+ * @param[in] max Maximum number of devices to initialise, limited by the pool's capacity.
+ * @return The number of devices initialised.
+ */
+size_t ds18b20_discover(const OneWireBus * bus, DS18B20_Pool * pool, size_t max);
+
+/**
+ * @brief Search a shared bus for DS18B20 devices, as ds18b20_discover(), holding the bus lock throughout.
+ *
+ * The lock is also set on every device initialised, as by ds18b20_use_bus_lock().
+ * @param[in] bus Pointer to initialised 1-Wire bus instance.
+ * @param[in] bus_lock Recursive mutex for the bus, or NULL to disable locking.
+ * @param[in] pool Pointer to pool instance.
+ * @param[in] max Maximum number of devices to initialise, limited by the pool's capacity.
+ * @return The number of devices initialised.
+ */
+size_t ds18b20_discover_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock, DS18B20_Pool * pool, size_t max);
+
 /**
  * @brief Initialise a device info instance with the specified GPIO.
  * @param[in] ds18b20_info Pointer to device info instance.
@@ -101,6 +351,20 @@ void ds18b20_free(DS18B20_Info ** ds18b20_info);
  */
 void ds18b20_init(DS18B20_Info * ds18b20_info, const OneWireBus * bus, OneWireBus_ROMCode rom_code);
 
+/**
+ * @brief Initialise a device info instance with a known resolution, without querying the device.
+ *
+ * This avoids any bus activity, for use when the resolution of the device is already known,
+ * for example because it was configured previously. The cached configuration is marked as
+ * not valid, so it is read from the device when first required.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] bus Pointer to initialised 1-Wire bus instance.
+ * @param[in] rom_code Device-specific ROM code to identify a device on the bus.
+ * @param[in] resolution Resolution currently configured in the device.
+ */
+void ds18b20_init_with_resolution(DS18B20_Info * ds18b20_info, const OneWireBus * bus, OneWireBus_ROMCode rom_code,
+                                  DS18B20_RESOLUTION resolution);
+
 /**
  * @brief Initialise a device info instance as a solo device on the bus.
  *
@@ -121,20 +385,254 @@ void ds18b20_init_solo(DS18B20_Info * ds18b20_info, const OneWireBus * bus);
  */
 void ds18b20_use_crc(DS18B20_Info * ds18b20_info, bool use_crc);
 
+/**
+ * @brief Enable or disable plausibility checks on temperature reads without CRC.
+ *
+ * When enabled, and CRC checks are disabled, temperature reads fetch the scratchpad up to
+ * and including the configuration register, and check that the alarm trigger and configuration
+ * registers match the cached values, that the value is not the power-on value, that it is within
+ * the operating range of the device, and that it has not changed by more than max_step since the
+ * last accepted value. If any check fails, the scratchpad is read again in full and the CRC checked.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] use_plausibility_check True to enable plausibility checks, false to disable.
+ * @param[in] max_step Largest plausible change between reads, in 1/16 degrees Celsius, or 0 for no limit.
+ * @param[in] crc_interval Perform a full CRC-checked read every this many reads regardless, or 0 for never.
+ */
+void ds18b20_use_plausibility_check(DS18B20_Info * ds18b20_info, bool use_plausibility_check,
+                                    uint16_t max_step, uint8_t crc_interval);
+
+/**
+ * @brief Enable or disable use of the calibrated conversion time.
+ *
+ * When enabled and a calibrated value is available, waits that cannot be ended early by the
+ * device signalling completion (parasitic power mode) use the calibrated conversion time plus
+ * DS18B20_CALIBRATION_GUARD_PERCENT, rather than the datasheet maximum.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] use_calibration True to enable use of the calibrated conversion time, false to disable.
+ */
+void ds18b20_use_calibration(DS18B20_Info * ds18b20_info, bool use_calibration);
+
+/**
+ * @brief Enable or disable low-power conversion waits.
+ *
+ * When enabled, waits for a conversion of this device do not poll the bus for completion, even in
+ * external power mode. The waiting task blocks until the (possibly calibrated) conversion deadline,
+ * leaving the CPU idle so that automatic light sleep can be entered, and the RTOS timer wakes it.
+ * No power management locks are held by this component at any time. Conversions are not detected
+ * early, so combine this with ds18b20_calibrate() and ds18b20_use_calibration() to minimise the wait.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] use_low_power_wait True to enable low-power waits, false to poll for completion where possible.
+ */
+void ds18b20_use_low_power_wait(DS18B20_Info * ds18b20_info, bool use_low_power_wait);
+
+/**
+ * @brief Enable or disable recovery of a device that has been reset by a loss of power.
+ *
+ * A device that browns out restarts with the configuration held in its EEPROM, and reports the
+ * power-on value of 85 degrees Celsius. When enabled, a read that returns this value re-applies the
+ * cached configuration to that device only, if it differs, and in external power mode starts a new
+ * conversion of that device, so that it can be read again after its conversion time. The read itself
+ * still reports DS18B20_ERROR_DEVICE. Other devices in a batch read are not affected.
+ *
+ * Only a full scratchpad read can tell the power-on value from a genuine 85 degrees, so when enabled,
+ * a partial read of that temperature is extended to a full, CRC-checked read.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] use_power_on_recovery True to enable recovery, false to report the error only.
+ */
+void ds18b20_use_power_on_recovery(DS18B20_Info * ds18b20_info, bool use_power_on_recovery);
+
+/**
+ * @brief Update the calibrated conversion time with a measured duration.
+ *
+ * The running maximum is kept as the equivalent 12-bit conversion time, so that it remains
+ * valid if the resolution is changed.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] elapsed_us Measured conversion time at the current resolution, in microseconds,
+ *                       for example as reported by ds18b20_wait_for_conversion_us().
+ */
+void ds18b20_calibration_update(DS18B20_Info * ds18b20_info, uint32_t elapsed_us);
+
+/**
+ * @brief Measure the conversion time of a device.
+ *
+ * Performs the specified number of conversions, measuring each with
+ * ds18b20_wait_for_conversion_us(), and updates the calibrated conversion time.
+ * The bus must be in external power mode, so that the device can signal completion.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] samples Number of conversions to measure.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_calibrate(DS18B20_Info * ds18b20_info, unsigned int samples);
+
+/**
+ * @brief Serialise this device's bus transactions with other tasks sharing the bus.
+ *
+ * The lock must be a recursive mutex (xSemaphoreCreateRecursiveMutex) shared by every device
+ * on the bus and by any other code that uses the bus. It is held only for the duration of each
+ * reset, ROM, command and data sequence, and is released while waiting for a conversion, so
+ * other tasks may use the bus in the meantime. As any such traffic ends the devices' completion
+ * signal, waits on a shared bus last for the (possibly calibrated) maximum conversion time
+ * rather than polling the bus.
+ *
+ * Functions taking only a bus have variants, such as ds18b20_convert_all_locked(), that take
+ * the lock for the duration of their transactions.
+ *
+ * In parasitic power mode the bus must not be used during a conversion, so
+ * ds18b20_convert_and_read_temp() holds the lock throughout. Callers that convert and read
+ * separately in this mode must take the lock themselves with xSemaphoreTakeRecursive(), and hold
+ * it until the conversion is complete. A conversion on a shared bus is refused otherwise.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] bus_lock Recursive mutex for the bus, or NULL to disable locking.
+ */
+void ds18b20_use_bus_lock(DS18B20_Info * ds18b20_info, SemaphoreHandle_t bus_lock);
+
+/**
+ * @brief Set the policy for retrying failed scratchpad reads.
+ *
+ * A failed read is repeated without starting a new conversion, as the result remains latched
+ * in the device. CRC and bus errors are considered transient, while a device that does not
+ * respond to a reset is likely to be missing, so each has its own number of retries.
+ * The delay before each retry starts at backoff_us and doubles each time, up to 128 times
+ * backoff_us, so a single delay never exceeds about 8.4 seconds. Delays shorter than one RTOS
+ * tick are busy-waited, longer delays block the calling task, rounded up to a whole tick.
+ * If the bus lock is in use, it may be held by the caller during the delay, so keep backoff_us
+ * small on shared buses. By default, no retries are made.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] crc_retries Maximum number of retries after a CRC or bus error.
+ * @param[in] presence_retries Maximum number of retries when the device does not respond.
+ * @param[in] backoff_us Delay before the first retry, in microseconds.
+ */
+void ds18b20_set_retry_policy(DS18B20_Info * ds18b20_info, uint8_t crc_retries, uint8_t presence_retries,
+                              uint16_t backoff_us);
+
+/**
+ * @brief Attach counters to a device, or detach them.
+ *
+ * Has no effect unless CONFIG_DS18B20_ENABLE_STATS is set.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] stats Pointer to counters to update, which may be shared between devices, or NULL to detach.
+ */
+void ds18b20_use_stats(DS18B20_Info * ds18b20_info, DS18B20_Stats * stats);
+
+/**
+ * @brief Set the counters attached to every device info instance when it is initialised.
+ *
+ * Initialisation otherwise detaches any counters, so this allows the bus transactions of
+ * initialisation itself to be counted. Functions that address all devices on a bus,
+ * such as ds18b20_convert_all(), also update these counters.
+ * Has no effect unless CONFIG_DS18B20_ENABLE_STATS is set.
+ * @param[in] stats Pointer to counters to attach, or NULL to attach none.
+ */
+void ds18b20_use_default_stats(DS18B20_Stats * stats);
+
+/**
+ * @brief Take a copy of a set of counters.
+ * @param[in] stats Pointer to counters.
+ * @param[out] snapshot Pointer to storage for the copy.
+ */
+void ds18b20_stats_snapshot(const DS18B20_Stats * stats, DS18B20_Stats * snapshot);
+
+/**
+ * @brief Reset a set of counters to zero.
+ * @param[in] stats Pointer to counters.
+ */
+void ds18b20_stats_reset(DS18B20_Stats * stats);
+
+/**
+ * @brief Format a set of counters as a single-line JSON object, for machine-readable reporting.
+ * @param[in] stats Pointer to counters.
+ * @param[out] buffer Buffer to receive the null-terminated string.
+ * @param[in] size Size of buffer in bytes.
+ * @return The length of the complete string, as for snprintf(). If this is not less than size,
+ *         the output was truncated. Negative on error.
+ */
+int ds18b20_stats_format(const DS18B20_Stats * stats, char * buffer, size_t size);
+
 /**
  * @brief Set temperature measurement resolution.
  *
  * This programs the hardware to the specified resolution and sets the cached value to be the same.
  * If the program fails, the value currently in hardware is used to refresh the cache.
  *
+ * The device scratchpad is only read if the cached configuration is not valid, and nothing
+ * is written if the device is already configured for the requested resolution.
+ *
  * @param[in] ds18b20_info Pointer to device info instance.
  * @param[in] resolution Selected resolution.
  * @return True if successful, otherwise false.
  */
 bool ds18b20_set_resolution(DS18B20_Info * ds18b20_info, DS18B20_RESOLUTION resolution);
 
+/**
+ * @brief Set the high and low temperature alarm triggers.
+ *
+ * This programs the device scratchpad only, see ds18b20_save_config() to make the change persistent.
+ * A device's alarm flag is set by a conversion with a result greater than or equal to high,
+ * or less than or equal to low. Nothing is written if the device already holds these values.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] high High alarm trigger (TH), in degrees Celsius.
+ * @param[in] low Low alarm trigger (TL), in degrees Celsius. Must not be greater than high.
+ * @return True if successful, otherwise false.
+ */
+bool ds18b20_set_alarm(DS18B20_Info * ds18b20_info, int8_t high, int8_t low);
+
+/**
+ * @brief Return the high and low temperature alarm triggers.
+ *
+ * The cached values are returned if valid, otherwise they are read from the device.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[out] high Optional pointer to the high alarm trigger (TH), in degrees Celsius.
+ * @param[out] low Optional pointer to the low alarm trigger (TL), in degrees Celsius.
+ * @return True if successful, otherwise false.
+ */
+bool ds18b20_read_alarm(DS18B20_Info * ds18b20_info, int8_t * high, int8_t * low);
+
+/**
+ * @brief Copy the alarm triggers and configuration register from the scratchpad to the device EEPROM.
+ *
+ * The values are then restored automatically when the device is next powered on.
+ * This blocks for the maximum EEPROM write time, with the strong pullup enabled in parasitic power mode.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @return True if successful, otherwise false.
+ */
+bool ds18b20_save_config(const DS18B20_Info * ds18b20_info);
+
+/**
+ * @brief Restore the alarm triggers and configuration register of a device from its EEPROM.
+ *
+ * The scratchpad values are replaced by those last saved with ds18b20_save_config(),
+ * and the cached configuration and resolution are refreshed from the device.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @return True if successful, otherwise false.
+ */
+bool ds18b20_recall_eeprom(DS18B20_Info * ds18b20_info);
+
+/**
+ * @brief Apply the same resolution and alarm triggers to every device on a bus in a single broadcast.
+ *
+ * The configuration is written to all devices at once with Skip ROM, and optionally copied to
+ * their EEPROM, then confirmed by reading back only the first five scratchpad bytes of each
+ * listed device. The cached configuration of each confirmed device is updated, so later calls
+ * to ds18b20_set_resolution() or ds18b20_set_alarm() with the same values do not access the bus.
+ * All devices on the bus are written, whether listed or not.
+ * If the devices are not all on the same bus, with the same bus lock, nothing is written and
+ * DS18B20_ERROR_ARGUMENT is returned.
+ * @param[in] devices Array of pointers to initialised device info instances, all on the same bus.
+ * @param[in] count Number of entries in devices.
+ * @param[in] resolution Resolution to set.
+ * @param[in] high High alarm trigger (TH), in degrees Celsius.
+ * @param[in] low Low alarm trigger (TL), in degrees Celsius, no greater than high.
+ * @param[in] save True to also copy the configuration to every device's EEPROM.
+ * @param[out] errs Optional array of count per-device verification results, may be NULL.
+ * @return DS18B20_OK if every device was confirmed, otherwise the first error encountered.
+ */
+DS18B20_ERROR ds18b20_configure_all(DS18B20_Info * const devices[], size_t count, DS18B20_RESOLUTION resolution,
+                                    int8_t high, int8_t low, bool save, DS18B20_ERROR * errs);
+
 /**
  * @brief Update and return the current temperature measurement resolution from the device.
+ *
+ * This also refreshes the cached alarm trigger and configuration registers.
  * @param[in] ds18b20_info Pointer to device info instance.
  * @return The currently configured temperature measurement resolution.
  */
@@ -149,7 +647,13 @@ OneWireBus_ROMCode ds18b20_read_rom(DS18B20_Info * ds18b20_info);
 
 /**
  * @brief Start a temperature measurement conversion on a single device.
+ *
+ * In parasitic power mode the strong pullup is enabled immediately after the command,
+ * and is released when the conversion is waited for, polled or notified as complete.
+ * On a shared bus in this mode, the calling task must hold the bus lock until the conversion
+ * is complete, otherwise the conversion is refused.
  * @param[in] ds18b20_info Pointer to device info instance.
+ * @return True if the conversion was started, otherwise false.
  */
 bool ds18b20_convert(const DS18B20_Info * ds18b20_info);
 
@@ -157,19 +661,119 @@ bool ds18b20_convert(const DS18B20_Info * ds18b20_info);
  * @brief Start temperature conversion on all connected devices.
  *
  * This should be followed by a sufficient delay to ensure all devices complete
- * their conversion before the measurements are read.
+ * their conversion before the measurements are read. In parasitic power mode on a shared bus,
+ * the calling task must hold the bus lock until the conversion is complete. Any wait for the conversion
+ * releases the strong pullup that this enables in parasitic power mode.
+ * The transaction is counted in the counters set by ds18b20_use_default_stats().
  * @param[in] bus Pointer to initialised bus instance.
  */
 void ds18b20_convert_all(const OneWireBus * bus);
 
+/**
+ * @brief Start temperature conversion on all devices on a shared bus, as ds18b20_convert_all(),
+ * holding the bus lock for the broadcast.
+ *
+ * In parasitic power mode, the calling task must already hold the lock, and hold it until the
+ * conversion is complete, otherwise the conversion is refused.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] bus_lock Recursive mutex for the bus, or NULL to disable locking.
+ * @return True if the conversion was started, otherwise false.
+ */
+bool ds18b20_convert_all_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock);
+
 /**
  * @brief Wait for the maximum conversion time according to the current resolution of the device.
  *        In external power mode, the device or devices can signal when conversion has completed.
  *        In parasitic power mode, this is not possible, so a pre-calculated delay is performed.
  * @param[in] ds18b20_info Pointer to device info instance.
- * @return An estimate of the time elapsed, in milliseconds. Actual elapsed time may be greater.
+ * @return The time elapsed, in milliseconds, in either mode.
+ */
+uint32_t ds18b20_wait_for_conversion(const DS18B20_Info * ds18b20_info);
+
+/**
+ * @brief Obtain the precomputed conversion timing for a resolution.
+ *
+ * All waits and deadlines in this component are taken from the same table.
+ * @param[in] resolution Resolution; an invalid resolution is treated as 12-bit, the worst case.
+ * @return Pointer to the timing entry for the resolution.
+ */
+const DS18B20_Timing * ds18b20_get_timing(DS18B20_RESOLUTION resolution);
+
+/**
+ * @brief Return the time after which a conversion of this device is complete, without polling.
+ *
+ * This is the deadline used by duration-based waits and asynchronous conversions: the datasheet
+ * maximum for the current resolution, or the calibrated time plus guard band if in use and shorter.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @return The conversion time, in microseconds.
+ */
+uint32_t ds18b20_get_conversion_time_us(const DS18B20_Info * ds18b20_info);
+
+/**
+ * @brief Wait for conversion to complete, with microsecond timing resolution.
+ *
+ * Unlike ds18b20_wait_for_conversion(), completion is not quantised to the RTOS tick.
+ * In external power mode the bus is polled from an esp_timer callback every poll_interval_us
+ * and the calling task is woken as soon as the devices release the bus. In parasitic power
+ * mode the calling task is woken by a one-shot esp_timer after the maximum conversion time.
+ * The calling task blocks on its task notification while waiting.
+ * @param[in] ds18b20_info Pointer to device info instance.
+ * @param[in] poll_interval_us Interval between polls of the bus in external power mode, in microseconds.
+ *                             If zero, DS18B20_DEFAULT_POLL_INTERVAL_US is used.
+ * @param[out] elapsed_us Optional pointer to the measured duration of the wait, in microseconds.
+ * @return DS18B20_OK if the conversion completed, DS18B20_ERROR_DEVICE if it timed out, otherwise error.
+ */
+DS18B20_ERROR ds18b20_wait_for_conversion_us(const DS18B20_Info * ds18b20_info, uint32_t poll_interval_us, uint32_t * elapsed_us);
+
+/**
+ * @brief Start a temperature conversion on a single device without waiting for it to complete.
+ *
+ * The conversion deadline is calculated from the cached resolution of the device.
+ * Use ds18b20_conversion_poll() or ds18b20_conversion_notify() to determine completion.
+ * @param[in] ds18b20_info Pointer to device info instance. Must be initialised first.
+ * @param[out] conversion Pointer to conversion state, updated with the conversion deadline.
+ * @return DS18B20_OK if the conversion was started, otherwise error.
  */
-float ds18b20_wait_for_conversion(const DS18B20_Info * ds18b20_info);
+DS18B20_ERROR ds18b20_convert_start(const DS18B20_Info * ds18b20_info, DS18B20_Conversion * conversion);
+
+/**
+ * @brief Start a temperature conversion on all connected devices without waiting for it to complete.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] resolution Highest resolution of any device on the bus, used to calculate the deadline.
+ *                       If invalid, the 12-bit conversion time is assumed.
+ * @param[out] conversion Pointer to conversion state, updated with the conversion deadline.
+ * @return DS18B20_OK if the conversion was started, otherwise error.
+ */
+DS18B20_ERROR ds18b20_convert_all_start(const OneWireBus * bus, DS18B20_RESOLUTION resolution, DS18B20_Conversion * conversion);
+
+/**
+ * @brief Determine whether an asynchronous conversion has completed, without blocking.
+ *
+ * In external power mode, the devices are asked whether conversion is complete with a single
+ * read time slot, so this may return true before the deadline. In parasitic power mode, this
+ * returns true once the deadline has passed.
+ * @param[in] conversion Pointer to conversion state started by ds18b20_convert_start() or ds18b20_convert_all_start().
+ * @return True if the conversion is complete, otherwise false.
+ */
+bool ds18b20_conversion_poll(DS18B20_Conversion * conversion);
+
+/**
+ * @brief Request notification when an asynchronous conversion reaches its deadline.
+ *
+ * The callback is invoked, and the task notified, from the esp_timer task. Either may be NULL.
+ * @param[in] conversion Pointer to conversion state started by ds18b20_convert_start() or ds18b20_convert_all_start().
+ * @param[in] callback Function to call on completion, or NULL.
+ * @param[in] context Context pointer passed to callback.
+ * @param[in] task Task to notify with xTaskNotifyGive() on completion, or NULL.
+ * @return DS18B20_OK if notification is scheduled, otherwise error.
+ */
+DS18B20_ERROR ds18b20_conversion_notify(DS18B20_Conversion * conversion, DS18B20_ConversionCallback callback, void * context, TaskHandle_t task);
+
+/**
+ * @brief Cancel any pending notification and release resources held by a conversion state.
+ * @param[in] conversion Pointer to conversion state.
+ */
+void ds18b20_conversion_release(DS18B20_Conversion * conversion);
 
 /**
  * @brief Read last temperature measurement from device.
@@ -177,10 +781,157 @@ float ds18b20_wait_for_conversion(const DS18B20_Info * ds18b20_info);
  * This is typically called after ds18b20_start_mass_conversion(), provided enough time
  * has elapsed to ensure that all devices have completed their conversions.
  * @param[in] ds18b20_info Pointer to device info instance. Must be initialised first.
+ * @param[out] value Pointer to the measurement value returned by the device, in degrees Celsius,
+ *                   or -2048.0 (DS18B20_RAW_INVALID) if the read fails.
+ * @return DS18B20_OK if read is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_read_temp(DS18B20_Info * ds18b20_info, float * value);
+
+/**
+ * @brief Read last temperature measurement from device as a fixed-point value.
+ *
+ * Identical to ds18b20_read_temp(), but without any floating-point conversion.
+ * Bits that are undefined at the current resolution are cleared.
+ * @param[in] ds18b20_info Pointer to device info instance. Must be initialised first.
+ * @param[out] value Pointer to the measurement value returned by the device, in 1/16 degrees Celsius.
+ * @return DS18B20_OK if read is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_read_temp_raw(DS18B20_Info * ds18b20_info, int16_t * value);
+
+/**
+ * @brief Read last temperature measurement from a device known to be valid.
+ *
+ * Identical to ds18b20_read_temp(), but the device info instance is not validated and
+ * nothing is logged, for use on hot paths. The caller must ensure that ds18b20_info is
+ * initialised and that value is not NULL.
+ * @param[in] ds18b20_info Pointer to initialised device info instance.
  * @param[out] value Pointer to the measurement value returned by the device, in degrees Celsius.
  * @return DS18B20_OK if read is successful, otherwise error.
  */
-DS18B20_ERROR ds18b20_read_temp(const DS18B20_Info * ds18b20_info, float * value);
+DS18B20_ERROR ds18b20_read_temp_trusted(DS18B20_Info * ds18b20_info, float * value);
+
+/**
+ * @brief Read last temperature measurement from a device known to be valid, as a fixed-point value.
+ *
+ * Identical to ds18b20_read_temp_raw(), but the device info instance is not validated and
+ * nothing is logged, for use on hot paths. The caller must ensure that ds18b20_info is
+ * initialised and that value is not NULL.
+ * @param[in] ds18b20_info Pointer to initialised device info instance.
+ * @param[out] value Pointer to the measurement value returned by the device, in 1/16 degrees Celsius.
+ * @return DS18B20_OK if read is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_read_temp_raw_trusted(DS18B20_Info * ds18b20_info, int16_t * value);
+
+/**
+ * @brief Convert a fixed-point measurement value to hundredths of a degree Celsius.
+ * @param[in] raw Measurement value in 1/16 degrees Celsius, as returned by ds18b20_read_temp_raw().
+ * @return Measurement value in 1/100 degrees Celsius, truncated towards zero.
+ */
+static inline int16_t ds18b20_raw_to_centi(int16_t raw)
+{
+    return (int16_t)(((int32_t)raw * 100) / 16);
+}
+
+/**
+ * @brief Read last temperature measurement from a set of devices in a single pass.
+ *
+ * This is typically called after ds18b20_convert_all() and a single call to
+ * ds18b20_wait_for_conversion(). All devices are validated before the bus is accessed,
+ * then each device is read back-to-back without per-device checks or logging.
+ * A failure on one device does not stop the remaining devices from being read, and its
+ * value is set to -2048.0 (DS18B20_RAW_INVALID), as for ds18b20_read_temp().
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[out] out Array of at least count measurement values, in degrees Celsius.
+ * @param[out] errs Optional array of at least count per-device results, may be NULL.
+ * @return DS18B20_OK if all reads are successful, otherwise the first per-device error.
+ */
+DS18B20_ERROR ds18b20_read_temp_multi(DS18B20_Info * const devices[], size_t count, float * out, DS18B20_ERROR * errs);
+
+/**
+ * @brief Read last temperature measurement from a set of devices in a single pass, as fixed-point values.
+ *
+ * Identical to ds18b20_read_temp_multi(), but without any floating-point conversion.
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[out] out Array of at least count measurement values, in 1/16 degrees Celsius.
+ * @param[out] errs Optional array of at least count per-device results, may be NULL.
+ * @return DS18B20_OK if all reads are successful, otherwise the first per-device error.
+ */
+DS18B20_ERROR ds18b20_read_temp_raw_multi(DS18B20_Info * const devices[], size_t count, int16_t * out, DS18B20_ERROR * errs);
+
+/**
+ * @brief Read last temperature measurement from a set of devices with mixed resolutions, shortest first.
+ *
+ * This is called after ds18b20_convert_all_start(), instead of waiting for the slowest device.
+ * Devices are read in stages of increasing resolution: each stage waits until the conversion time
+ * of its devices has elapsed since the conversion started, reads them, and then invokes the
+ * optional callback, so that the results of low-resolution devices are available early.
+ * Devices with an unknown resolution are read with the 12-bit devices.
+ * @param[in] conversion Pointer to conversion state started by ds18b20_convert_all_start().
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[out] out Array of at least count measurement values, in degrees Celsius.
+ * @param[out] errs Optional array of at least count per-device results, may be NULL.
+ * @param[in] callback Optional function to call after each stage, may be NULL.
+ * @param[in] context Context pointer passed to callback.
+ * @return DS18B20_OK if all reads are successful, otherwise the first per-device error.
+ */
+DS18B20_ERROR ds18b20_read_temp_multi_staged(const DS18B20_Conversion * conversion,
+                                             DS18B20_Info * const devices[], size_t count,
+                                             float * out, DS18B20_ERROR * errs,
+                                             DS18B20_StageCallback callback, void * context);
+
+/**
+ * @brief Read last temperature measurement from every allocated device in a pool, in slot order.
+ *
+ * Equivalent to ds18b20_read_temp_multi() over the pool's allocated slots.
+ * @param[in] pool Pointer to pool whose allocated slots are all initialised.
+ * @param[out] out Array of at least pool->count measurement values, in degrees Celsius.
+ * @param[out] errs Optional array of at least pool->count per-device results, may be NULL.
+ * @return DS18B20_OK if all reads are successful, otherwise the first per-device error.
+ */
+DS18B20_ERROR ds18b20_pool_read_temp(DS18B20_Pool * pool, float * out, DS18B20_ERROR * errs);
+
+/**
+ * @brief Find the devices on a bus whose alarm flag was set by the last conversion.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[out] rom_codes Array to receive the ROM codes of the alarmed devices.
+ * @param[in] max_count Number of entries in rom_codes.
+ * @param[out] count Number of ROM codes found.
+ * @return DS18B20_OK if the search is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_alarm_search(const OneWireBus * bus, OneWireBus_ROMCode * rom_codes, size_t max_count, size_t * count);
+
+/**
+ * @brief Find the alarmed devices on a shared bus, as ds18b20_alarm_search(), holding the bus
+ * lock for each search pass.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] bus_lock Recursive mutex for the bus, or NULL to disable locking.
+ * @param[out] rom_codes Array to receive the ROM codes of the alarmed devices.
+ * @param[in] max_count Number of entries in rom_codes.
+ * @param[out] count Number of ROM codes found.
+ * @return DS18B20_OK if the search is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_alarm_search_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock,
+                                          OneWireBus_ROMCode * rom_codes, size_t max_count, size_t * count);
+
+/**
+ * @brief Read last temperature measurement only from those devices whose alarm flag is set.
+ *
+ * This is typically called after ds18b20_convert_all() and ds18b20_wait_for_conversion().
+ * An alarm search is performed on the bus of the first device, and each alarmed device found
+ * in devices is read. Devices that are not alarmed are not read, and their entry in out is
+ * left unchanged. All devices must be on the same bus, and must not be solo devices.
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[out] out Array of at least count measurement values, in degrees Celsius.
+ * @param[out] errs Optional array of at least count per-device results, may be NULL.
+ * @param[out] alarmed Array of at least count flags, set true for each device that was alarmed and read.
+ * @return DS18B20_OK if all reads are successful, otherwise the first per-device error.
+ */
+DS18B20_ERROR ds18b20_read_temp_alarmed(DS18B20_Info * const devices[], size_t count,
+                                        float * out, DS18B20_ERROR * errs, bool * alarmed);
 
 /**
  * @brief Convert, wait and read current temperature from device.
@@ -188,7 +939,7 @@ DS18B20_ERROR ds18b20_read_temp(const DS18B20_Info * ds18b20_info, float * value
  * @param[out] value Pointer to the measurement value returned by the device, in degrees Celsius.
  * @return DS18B20_OK if read is successful, otherwise error.
  */
-DS18B20_ERROR ds18b20_convert_and_read_temp(const DS18B20_Info * ds18b20_info, float * value);
+DS18B20_ERROR ds18b20_convert_and_read_temp(DS18B20_Info * ds18b20_info, float * value);
 
 /**
  * @brief Check OneWire bus for presence of parasitic-powered devices.
@@ -199,6 +950,16 @@ DS18B20_ERROR ds18b20_convert_and_read_temp(const DS18B20_Info * ds18b20_info, f
  */
 DS18B20_ERROR ds18b20_check_for_parasite_power(const OneWireBus * bus, bool * present);
 
+/**
+ * @brief Check a shared bus for parasitic-powered devices, as ds18b20_check_for_parasite_power(),
+ * holding the bus lock for the check.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] bus_lock Recursive mutex for the bus, or NULL to disable locking.
+ * @param[out] present Result value, true if a parasitic-powered device was detected.
+ * @return DS18B20_OK if check is successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_check_for_parasite_power_locked(const OneWireBus * bus, SemaphoreHandle_t bus_lock, bool * present);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_adaptive.h
+ * @brief Interface definitions for adaptive control of DS18B20 measurement resolution.
+ *
+ * Conversion time doubles with each additional bit of resolution. An adaptive controller
+ * lowers the resolution of a device while its readings are stable and far from the
+ * thresholds of interest, and raises it when readings change quickly or approach a
+ * threshold, so that full precision is only paid for where it matters.
+ */
+
+#ifndef DS18B20_ADAPTIVE_H
+#define DS18B20_ADAPTIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Structure containing the policy of an adaptive resolution controller.
+ *
+ * All temperatures are raw values, in units of 1/16 degree Celsius.
+ */
+typedef struct
+{
+    int16_t threshold_low;               ///< Lower threshold of interest
+    int16_t threshold_high;              ///< Upper threshold of interest
+    uint16_t margin;                     ///< Readings this close to either threshold use the maximum resolution
+    uint16_t stable_step;                ///< Readings that change by no more than this are considered stable
+    uint8_t stable_count;                ///< Number of consecutive stable readings before resolution is lowered
+    DS18B20_RESOLUTION min_resolution;   ///< Lowest resolution to use
+    DS18B20_RESOLUTION max_resolution;   ///< Highest resolution to use
+} DS18B20_AdaptiveConfig;
+
+/**
+ * @brief Structure containing the state of an adaptive resolution controller for one device.
+ */
+typedef struct
+{
+    DS18B20_Info * ds18b20_info;         ///< Pointer to the controlled device
+    DS18B20_AdaptiveConfig config;       ///< Control policy
+    int16_t last_raw;                    ///< Previous reading
+    uint8_t stable;                      ///< Number of consecutive stable readings
+    bool has_last;                       ///< True if last_raw holds a reading
+} DS18B20_Adaptive;
+
+/**
+ * @brief Initialise an adaptive resolution controller for a device.
+ *
+ * The device's resolution is not changed until the first update.
+ * @param[in] adaptive Pointer to controller instance.
+ * @param[in] ds18b20_info Pointer to initialised device info instance.
+ * @param[in] config Pointer to control policy, which is copied.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_adaptive_init(DS18B20_Adaptive * adaptive, DS18B20_Info * ds18b20_info,
+                                    const DS18B20_AdaptiveConfig * config);
+
+/**
+ * @brief Update the controller with the latest reading from its device, and adjust the resolution.
+ *
+ * The resolution is raised to the maximum as soon as a reading is within the margin of a threshold,
+ * raised by one bit when a reading is not stable, and lowered by one bit after
+ * the configured number of consecutive stable readings. The device is only written when the
+ * resolution changes; the cached configuration avoids any read beforehand.
+ * The new resolution applies from the next conversion.
+ * @param[in] adaptive Pointer to controller instance.
+ * @param[in] raw Latest reading, as returned by ds18b20_read_temp_raw().
+ * @return The resolution to be used for the next conversion.
+ */
+DS18B20_RESOLUTION ds18b20_adaptive_update(DS18B20_Adaptive * adaptive, int16_t raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_ADAPTIVE_H
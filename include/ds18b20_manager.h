@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_manager.h
+ * @brief Interface definitions for sampling several 1-Wire buses with one worker task per bus.
+ *
+ * A manager creates a sampler for each bus, each with its own core affinity and priority, so that
+ * timing-sensitive bus I/O can be kept away from other work such as the WiFi stack. Each worker
+ * hands its samples to the application through a lock-free single-producer, single-consumer
+ * queue for its bus.
+ */
+
+#ifndef DS18B20_MANAGER_H
+#define DS18B20_MANAGER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20_sampler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Structure containing the configuration of one bus of a manager.
+ */
+typedef struct
+{
+    DS18B20_SamplerConfig sampler;  ///< Configuration of the bus worker. The callback and context must be NULL.
+    size_t queue_length;            ///< Minimum number of samples the bus queue can hold, rounded up to a power of two
+} DS18B20_ManagerBusConfig;
+
+/**
+ * @brief Opaque handle to a manager instance.
+ */
+typedef struct DS18B20_Manager DS18B20_Manager;
+
+/**
+ * @brief Construct a new manager and start a worker task for each bus.
+ * @param[in] buses Array of bus configurations, which are copied.
+ * @param[in] count Number of entries in buses.
+ * @return Pointer to new manager instance, or NULL if it cannot be created.
+ */
+DS18B20_Manager * ds18b20_manager_create(const DS18B20_ManagerBusConfig * buses, size_t count);
+
+/**
+ * @brief Stop all worker tasks and delete an existing manager instance.
+ * @param[in,out] manager Pointer to manager instance pointer that will be freed and set to NULL.
+ */
+void ds18b20_manager_delete(DS18B20_Manager ** manager);
+
+/**
+ * @brief Take the oldest sample from a bus queue, without blocking.
+ *
+ * Each bus queue must be drained by a single task only.
+ * @param[in] manager Pointer to manager instance.
+ * @param[in] bus Index of the bus in the configured buses array.
+ * @param[out] event Pointer to storage for the sample and the index of its device.
+ * @return True if a sample was taken, false if the queue is empty.
+ */
+bool ds18b20_manager_receive(DS18B20_Manager * manager, size_t bus, DS18B20_SampleEvent * event);
+
+/**
+ * @brief Return the number of samples discarded because a bus queue was full.
+ * @param[in] manager Pointer to manager instance.
+ * @param[in] bus Index of the bus in the configured buses array.
+ * @return The number of discarded samples.
+ */
+uint32_t ds18b20_manager_get_overflows(const DS18B20_Manager * manager, size_t bus);
+
+/**
+ * @brief Return the sampler of a bus, for access to its latest values and subscriptions.
+ * @param[in] manager Pointer to manager instance.
+ * @param[in] bus Index of the bus in the configured buses array.
+ * @return Pointer to sampler instance, or NULL if bus is out of range.
+ */
+DS18B20_Sampler * ds18b20_manager_get_sampler(const DS18B20_Manager * manager, size_t bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_MANAGER_H
@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_sampler.h
+ * @brief Interface definitions for a background task that continuously samples
+ *        all DS18B20 devices on a 1-Wire bus.
+ *
+ * The sampler task performs one conversion of every device per period, and publishes
+ * the latest value of each device into a buffer that any number of tasks may read
+ * without locking and without accessing the bus.
+ */
+
+#ifndef DS18B20_SAMPLER_H
+#define DS18B20_SAMPLER_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS18B20_SAMPLER_DEFAULT_STACK_SIZE 2048  ///< Default stack size of the sampler task, in bytes
+
+/**
+ * @brief Structure containing a sample delivered by the sampler task, for example as a change notification.
+ */
+typedef struct
+{
+    size_t index;             ///< Index of the device in the configured devices array
+    DS18B20_Sample sample;    ///< The sample
+} DS18B20_SampleEvent;
+
+/**
+ * @brief Callback invoked by the sampler task with a sample, when configured or subscribed.
+ * @param[in] event The sample.
+ * @param[in] context Context pointer provided with the callback.
+ */
+typedef void (*DS18B20_SubscriptionCallback)(const DS18B20_SampleEvent * event, void * context);
+
+/**
+ * @brief Structure containing the configuration of a sampler.
+ */
+typedef struct
+{
+    const OneWireBus * bus;                ///< Pointer to initialised 1-Wire bus instance
+    DS18B20_Info * const * devices;        ///< Array of pointers to initialised devices on this bus
+    size_t count;                          ///< Number of entries in devices
+    uint32_t period_ms;                    ///< Sampling period, in milliseconds
+    UBaseType_t priority;                  ///< Priority of the sampler task
+    uint32_t stack_size;                   ///< Stack size of the sampler task in bytes, or 0 for the default
+    BaseType_t core_id;                    ///< Core to pin the sampler task to, or tskNO_AFFINITY
+    DS18B20_SubscriptionCallback callback; ///< Optional callback invoked by the sampler task with every sample
+    void * context;                        ///< Context pointer passed to callback
+} DS18B20_SamplerConfig;
+
+/**
+ * @brief Opaque handle to a sampler instance.
+ */
+typedef struct DS18B20_Sampler DS18B20_Sampler;
+
+/**
+ * @brief Structure containing a subscription to changes of a device's temperature.
+ *
+ * Storage is provided by the caller, and must remain valid until unsubscribed.
+ * Members are managed by the sampler and should not be modified while subscribed.
+ */
+typedef struct DS18B20_Subscription
+{
+    struct DS18B20_Subscription * next;    ///< Next subscription of the same sampler
+    DS18B20_SubscriptionCallback callback; ///< Optional callback invoked on change
+    void * context;                        ///< Context pointer passed to callback
+    QueueHandle_t queue;                   ///< Optional queue of DS18B20_SampleEvent to post to on change
+    size_t index;                          ///< Index of the subscribed device
+    float deadband;                        ///< Change from the last notified value required for a notification, in degrees Celsius
+    float reference;                       ///< Last notified value
+    bool has_reference;                    ///< True if reference holds a valid value
+} DS18B20_Subscription;
+
+/**
+ * @brief Construct a new sampler and start its task.
+ *
+ * The devices, and the array of pointers to them, must remain valid until the sampler is deleted.
+ * Nothing else may access the bus while the sampler is running.
+ * @param[in] config Pointer to sampler configuration, which is copied.
+ * @return Pointer to new sampler instance, or NULL if it cannot be created.
+ */
+DS18B20_Sampler * ds18b20_sampler_create(const DS18B20_SamplerConfig * config);
+
+/**
+ * @brief Stop the sampler task and delete an existing sampler instance.
+ *
+ * Blocks until the sampler task finishes its current cycle, which may take up to one period.
+ * Must not be called from a callback invoked by the sampler task.
+ * @param[in,out] sampler Pointer to sampler instance pointer that will be freed and set to NULL.
+ */
+void ds18b20_sampler_delete(DS18B20_Sampler ** sampler);
+
+/**
+ * @brief Retrieve the latest published sample for a device, without blocking.
+ *
+ * Safe to call from any task, on any core, concurrently with the sampler task.
+ * Until the first sample is published, the sample error is DS18B20_ERROR_UNKNOWN.
+ * @param[in] sampler Pointer to sampler instance.
+ * @param[in] index Index of the device in the configured devices array.
+ * @param[out] sample Pointer to storage for the sample.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_sampler_get(const DS18B20_Sampler * sampler, size_t index, DS18B20_Sample * sample);
+
+/**
+ * @brief Return the number of sampling cycles completed by the sampler task.
+ * @param[in] sampler Pointer to sampler instance.
+ * @return The number of completed cycles.
+ */
+uint32_t ds18b20_sampler_get_cycles(const DS18B20_Sampler * sampler);
+
+/**
+ * @brief Subscribe to changes in a device's temperature that exceed a deadband.
+ *
+ * A notification is delivered for the first valid sample, for each sample that differs from
+ * the last notified value by more than the deadband, and once when the device begins to fail.
+ * Notifications are delivered by the sampler task, to the callback and then to the queue if
+ * either is provided. Posting to the queue does not block, so events are discarded if it is full.
+ * The callback must not block and must not subscribe or unsubscribe.
+ * @param[in] sampler Pointer to sampler instance.
+ * @param[in] subscription Pointer to caller-provided subscription storage.
+ * @param[in] index Index of the device in the configured devices array.
+ * @param[in] deadband Change required for a notification, in degrees Celsius.
+ * @param[in] callback Callback to invoke on change, or NULL.
+ * @param[in] context Context pointer passed to callback.
+ * @param[in] queue Queue of DS18B20_SampleEvent to post to on change, or NULL.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_sampler_subscribe(DS18B20_Sampler * sampler, DS18B20_Subscription * subscription,
+                                        size_t index, float deadband,
+                                        DS18B20_SubscriptionCallback callback, void * context, QueueHandle_t queue);
+
+/**
+ * @brief Remove a subscription. Once this returns, no further notifications are delivered for it.
+ * @param[in] sampler Pointer to sampler instance.
+ * @param[in] subscription Pointer to subscription previously passed to ds18b20_sampler_subscribe().
+ */
+void ds18b20_sampler_unsubscribe(DS18B20_Sampler * sampler, DS18B20_Subscription * subscription);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_SAMPLER_H
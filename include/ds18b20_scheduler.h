@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_scheduler.h
+ * @brief Interface definitions for pipelined sampling of DS18B20 devices across
+ *        multiple 1-Wire buses.
+ *
+ * Conversions are started on every bus before any results are read, so that the
+ * conversion windows of all buses overlap. Each bus is read as soon as its own
+ * conversion completes, while the remaining buses are still converting, and the
+ * results are published into a shared, timestamped snapshot buffer.
+ */
+
+#ifndef DS18B20_SCHEDULER_H
+#define DS18B20_SCHEDULER_H
+
+#include "freertos/FreeRTOS.h"
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Structure describing a single 1-Wire bus managed by the scheduler.
+ *
+ * The caller sets bus, devices, count and samples before calling ds18b20_scheduler_init().
+ * The remaining members are managed by the scheduler.
+ */
+typedef struct
+{
+    const OneWireBus * bus;                ///< Pointer to initialised 1-Wire bus instance
+    DS18B20_Info * const * devices;        ///< Array of pointers to initialised devices on this bus
+    size_t count;                          ///< Number of entries in devices
+    DS18B20_Sample * samples;              ///< Snapshot buffer of count entries, one per device
+
+    DS18B20_RESOLUTION resolution;         ///< Highest resolution of any device on this bus, updated as each conversion starts
+    DS18B20_Conversion conversion;         ///< State of the conversion in progress on this bus
+    bool pending;                          ///< True while a conversion is in progress on this bus
+    int64_t timestamp;                     ///< Time at which this bus's snapshot was last published, in microseconds
+    float * values;                        ///< Scratch storage of count entries, for the readings of a batch before it is published
+    DS18B20_ERROR * errs;                  ///< Scratch storage of count entries, for the results of a batch before it is published
+} DS18B20_SchedulerBus;
+
+/**
+ * @brief Structure containing the state of a multi-bus scheduler.
+ */
+typedef struct
+{
+    DS18B20_SchedulerBus * buses;  ///< Array of managed buses
+    size_t count;                  ///< Number of entries in buses
+    uint32_t sequence;             ///< Incremented every time a bus snapshot is published
+    portMUX_TYPE lock;             ///< Protects the snapshot buffers
+} DS18B20_Scheduler;
+
+/**
+ * @brief Initialise a scheduler for a set of buses.
+ *
+ * The scratch storage for each bus is allocated here, so that sampling does not allocate.
+ * @param[in] scheduler Pointer to scheduler instance.
+ * @param[in] buses Array of bus descriptions, each with bus, devices, count and samples set.
+ * @param[in] count Number of entries in buses.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_scheduler_init(DS18B20_Scheduler * scheduler, DS18B20_SchedulerBus * buses, size_t count);
+
+/**
+ * @brief Release resources held by a scheduler, including the scratch storage of its buses.
+ * @param[in] scheduler Pointer to scheduler instance.
+ */
+void ds18b20_scheduler_deinit(DS18B20_Scheduler * scheduler);
+
+/**
+ * @brief Advance the scheduler without blocking.
+ *
+ * Any idle bus has a conversion started on it. Any bus whose conversion has completed
+ * is read and its snapshot published; it will have its next conversion started on the
+ * following call. Call this repeatedly to sample continuously.
+ * @param[in] scheduler Pointer to initialised scheduler instance.
+ * @return The number of buses whose snapshot was published by this call.
+ */
+size_t ds18b20_scheduler_step(DS18B20_Scheduler * scheduler);
+
+/**
+ * @brief Sample every bus exactly once, with overlapping conversions.
+ *
+ * Blocks until every bus has published a new snapshot. The total duration approaches
+ * a single conversion time, plus the time taken to read the devices.
+ * @param[in] scheduler Pointer to initialised scheduler instance.
+ * @return DS18B20_OK if every device was read successfully, otherwise the first error encountered.
+ */
+DS18B20_ERROR ds18b20_scheduler_run_cycle(DS18B20_Scheduler * scheduler);
+
+/**
+ * @brief Copy the most recently published sample for a device from the snapshot buffer.
+ * @param[in] scheduler Pointer to initialised scheduler instance.
+ * @param[in] bus_index Index of the bus in the scheduler.
+ * @param[in] device_index Index of the device on that bus.
+ * @param[out] sample Pointer to storage for the sample.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_scheduler_get_sample(DS18B20_Scheduler * scheduler, size_t bus_index, size_t device_index, DS18B20_Sample * sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_SCHEDULER_H
@@ -0,0 +1,184 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_stream.h
+ * @brief Interface definitions for a compact ring buffer of raw temperature samples.
+ *
+ * A sample stream stores one frame per sampling cycle, holding a raw reading for each of a
+ * fixed number of channels (devices), as returned by ds18b20_read_temp_raw(). Consecutive
+ * readings of each channel are delta-encoded in units of the channel's resolution, so that
+ * a reading that changes slowly occupies a single 4-bit nibble rather than 16 bits.
+ *
+ * Frames are packed into fixed-size blocks. Each block begins with a keyframe, so it can be
+ * decoded without reference to any other block, and the oldest closed block can be drained
+ * without copying. When the buffer is full, the oldest block is overwritten.
+ *
+ * A stream is not thread-safe: appending and draining must be performed by the same task,
+ * or be serialised by the caller.
+ */
+
+#ifndef DS18B20_STREAM_H
+#define DS18B20_STREAM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS18B20_STREAM_HEADER_SIZE 6  ///< Size of the header at the start of each block, in bytes
+
+/**
+ * @brief Structure containing the header of an encoded block.
+ */
+typedef struct
+{
+    uint32_t first_frame;  ///< Sequence number of the first frame in the block, to detect gaps
+    uint8_t frames;        ///< Number of frames in the block
+    uint8_t channels;      ///< Number of readings in each frame
+} DS18B20_StreamHeader;
+
+/**
+ * @brief Structure containing the state of a sample stream.
+ */
+typedef struct
+{
+    uint8_t * blocks;      ///< Storage for the ring of blocks
+    int16_t * previous;    ///< Last reading appended to each channel in the open block
+    uint8_t * shifts;      ///< Delta shift of each channel, from its resolution
+    size_t block_size;     ///< Size of each block, in bytes
+    size_t block_count;    ///< Number of blocks in the ring
+    size_t channels;       ///< Number of readings in each frame
+    size_t head;           ///< Index of the oldest closed block
+    size_t used;           ///< Number of closed blocks waiting to be drained
+    size_t nibbles;        ///< Number of nibbles written to the open block
+    uint32_t sequence;     ///< Sequence number of the next frame to be appended
+    uint32_t dropped;      ///< Number of blocks overwritten before they were drained
+    bool open;             ///< True if a block is open for appending
+} DS18B20_Stream;
+
+/**
+ * @brief Calculate the size of the storage required for a sample stream.
+ * @param[in] channels Number of readings in each frame.
+ * @param[in] block_size Size of each block, in bytes.
+ * @param[in] block_count Number of blocks in the ring.
+ * @return Size of the required storage, in bytes.
+ */
+size_t ds18b20_stream_storage_size(size_t channels, size_t block_size, size_t block_count);
+
+/**
+ * @brief Initialise a sample stream using caller-supplied storage.
+ *
+ * Each block must be large enough to hold the delta shifts and a keyframe of all channels.
+ * @param[in] stream Pointer to stream instance.
+ * @param[in] storage Storage of at least ds18b20_stream_storage_size() bytes, aligned for int16_t.
+ * @param[in] channels Number of readings in each frame, from 1 to 255.
+ * @param[in] block_size Size of each block, in bytes.
+ * @param[in] block_count Number of blocks in the ring, at least 1.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_stream_init(DS18B20_Stream * stream, void * storage, size_t channels,
+                                  size_t block_size, size_t block_count);
+
+/**
+ * @brief Append a frame of readings to a sample stream.
+ *
+ * If the open block cannot hold the frame, it is closed and a new block is opened,
+ * overwriting the oldest block if the ring is full.
+ * @param[in] stream Pointer to stream instance.
+ * @param[in] raw Array of one raw reading per channel, in units of 1/16 degree Celsius.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_stream_append(DS18B20_Stream * stream, const int16_t * raw);
+
+/**
+ * @brief Set the resolution of the readings of one channel.
+ *
+ * Deltas are stored in units of the resolution LSB, so that a one-step change at 9-bit
+ * resolution still fits in a single nibble. Channels default to 12-bit resolution.
+ * If the resolution changes, the open block is closed, as the setting is recorded per block.
+ * Readings that do not match the resolution are still stored exactly, but less compactly.
+ * @param[in] stream Pointer to stream instance.
+ * @param[in] channel Index of the channel.
+ * @param[in] resolution Resolution of the channel's readings.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_stream_set_resolution(DS18B20_Stream * stream, size_t channel, DS18B20_RESOLUTION resolution);
+
+/**
+ * @brief Close the open block, if it holds any frames, so that it can be drained.
+ * @param[in] stream Pointer to stream instance.
+ */
+void ds18b20_stream_flush(DS18B20_Stream * stream);
+
+/**
+ * @brief Obtain the oldest closed block without copying it.
+ *
+ * The block remains valid until it is consumed with ds18b20_stream_consume(), or until
+ * it is overwritten by a later append.
+ * @param[in] stream Pointer to stream instance.
+ * @param[out] block Set to the start of the block.
+ * @param[out] size Set to the size of the block, in bytes.
+ * @param[out] header Optional pointer to storage for the block header, may be NULL.
+ * @return True if a closed block is available, otherwise false.
+ */
+bool ds18b20_stream_peek(const DS18B20_Stream * stream, const uint8_t ** block, size_t * size,
+                         DS18B20_StreamHeader * header);
+
+/**
+ * @brief Release the oldest closed block, after it has been obtained by ds18b20_stream_peek().
+ *
+ * If an append has overwritten the peeked block in the meantime, nothing is released, as the
+ * oldest block is then a different one, and any data taken from the peeked block should be
+ * discarded. The overwritten block is counted in dropped.
+ * @param[in] stream Pointer to stream instance.
+ * @param[in] first_frame Sequence number of the first frame of the peeked block, from its header.
+ * @return True if the peeked block was released, false if it had been overwritten.
+ */
+bool ds18b20_stream_consume(DS18B20_Stream * stream, uint32_t first_frame);
+
+/**
+ * @brief Decode an encoded block into raw readings.
+ *
+ * Does not require a stream instance, so it may be used wherever the block is received.
+ * @param[in] block Pointer to encoded block.
+ * @param[in] size Size of the encoded block, in bytes.
+ * @param[out] header Optional pointer to storage for the block header, may be NULL.
+ * @param[out] raw Array to receive frames * channels readings, in frame order.
+ * @param[in] capacity Number of entries in raw.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_stream_decode(const uint8_t * block, size_t size, DS18B20_StreamHeader * header,
+                                    int16_t * raw, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_STREAM_H
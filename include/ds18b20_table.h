@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_table.h
+ * @brief Interface definitions for persisting a table of DS18B20 device info instances.
+ *
+ * A device table records the ROM code, resolution, CRC setting and cached configuration
+ * of each device on a bus, along with the bus power mode. Restoring a table initialises
+ * each device info instance without any bus activity; the restored configuration is
+ * confirmed against the device as part of the first temperature read.
+ */
+
+#ifndef DS18B20_TABLE_H
+#define DS18B20_TABLE_H
+
+#include "nvs.h"
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Calculate the size of a serialised device table.
+ * @param[in] count Number of devices in the table.
+ * @return Size of the serialised table, in bytes.
+ */
+size_t ds18b20_table_size(size_t count);
+
+/**
+ * @brief Serialise a set of device info instances into a caller-supplied buffer.
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[in] parasitic_power True if the bus uses parasitic power, as reported by ds18b20_check_for_parasite_power().
+ * @param[out] buffer Buffer to receive the serialised table.
+ * @param[in,out] size On entry, the size of buffer. On exit, the number of bytes written.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_table_save(const DS18B20_Info * const devices[], size_t count, bool parasitic_power,
+                                 void * buffer, size_t * size);
+
+/**
+ * @brief Restore a set of device info instances from a serialised table, without bus activity.
+ * @param[out] devices Array of pointers to device info instances to initialise.
+ * @param[in] max_count Number of entries in devices.
+ * @param[in] bus Pointer to initialised 1-Wire bus instance the devices are connected to.
+ * @param[in] buffer Buffer containing the serialised table.
+ * @param[in] size Size of the serialised table, in bytes.
+ * @param[out] count Number of device info instances restored.
+ * @param[out] parasitic_power Optional, set to the recorded bus power mode. The caller may pass this
+ *                             to owb_use_parasitic_power() instead of calling ds18b20_check_for_parasite_power().
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_table_restore(DS18B20_Info * const devices[], size_t max_count, const OneWireBus * bus,
+                                    const void * buffer, size_t size, size_t * count, bool * parasitic_power);
+
+/**
+ * @brief Serialise a set of device info instances into an NVS blob.
+ *
+ * The blob is committed before returning.
+ * @param[in] handle Open, writable NVS handle.
+ * @param[in] key NVS key for the blob.
+ * @param[in] devices Array of pointers to initialised device info instances.
+ * @param[in] count Number of entries in devices.
+ * @param[in] parasitic_power True if the bus uses parasitic power.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_table_save_nvs(nvs_handle_t handle, const char * key,
+                                     const DS18B20_Info * const devices[], size_t count, bool parasitic_power);
+
+/**
+ * @brief Restore a set of device info instances from an NVS blob, without bus activity.
+ * @param[in] handle Open NVS handle.
+ * @param[in] key NVS key for the blob.
+ * @param[out] devices Array of pointers to device info instances to initialise.
+ * @param[in] max_count Number of entries in devices.
+ * @param[in] bus Pointer to initialised 1-Wire bus instance the devices are connected to.
+ * @param[out] count Number of device info instances restored.
+ * @param[out] parasitic_power Optional, set to the recorded bus power mode.
+ * @return DS18B20_OK if successful, otherwise error.
+ */
+DS18B20_ERROR ds18b20_table_restore_nvs(nvs_handle_t handle, const char * key,
+                                        DS18B20_Info * const devices[], size_t max_count, const OneWireBus * bus,
+                                        size_t * count, bool * parasitic_power);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_TABLE_H
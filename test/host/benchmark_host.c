@@ -0,0 +1,54 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file benchmark_host.c
+ * @brief Runs the on-target benchmark scenarios against the simulated bus, on the simulated clock.
+ */
+
+#include <stdio.h>
+
+#include "ds18b20_sim.h"
+#include "benchmark.h"
+
+#define DEVICES 4
+#define ITERATIONS 3
+
+int main(void)
+{
+    static DS18B20_SimBus sim;
+    ds18b20_sim_init(&sim, false);
+    for (int i = 0; i < DEVICES; ++i)
+    {
+        ds18b20_sim_add_device(&sim, i + 1, 20.0f + i);
+    }
+
+    int failures = benchmark_run(&sim.bus, ITERATIONS);
+    if (failures != 0)
+    {
+        fprintf(stderr, "benchmark: %d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,638 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_sim.c
+ *
+ * The bus moves through the 1-Wire transaction phases: a reset puts every present device into
+ * the ROM command phase, a ROM command selects one or all devices, or starts a search, and the
+ * selected devices then execute a single function command. Read slots return the wired-AND of
+ * every responding device, so that multi-device reads and searches behave as on a real bus.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_timer.h"
+
+#include "ds18b20_sim.h"
+#include "host_rtos.h"
+
+// standard speed timing, in microseconds
+#define T_RESET_US   960   // reset pulse and presence detect
+#define T_SLOT_US    70    // a single read or write slot
+#define T_COPY_US    10000 // EEPROM write
+#define T_RECALL_US  500   // EEPROM recall
+#define T_SPON_US    10    // maximum delay from Convert T to enabling the strong pullup
+
+// factory EEPROM contents: alarms at the limits of the operating range, 12-bit resolution
+#define DEFAULT_TH      0x7d
+#define DEFAULT_TL      0xc9
+#define DEFAULT_CONFIG  0x7f
+
+enum
+{
+    STATE_IDLE,         // waiting for a reset
+    STATE_ROM,          // waiting for a ROM command
+    STATE_MATCH,        // receiving the ROM code of a Match ROM command
+    STATE_SEARCH,       // Search ROM or Alarm Search in progress
+    STATE_FUNCTION,     // waiting for a function command
+    STATE_READ,         // Read Scratchpad in progress
+    STATE_WRITE,        // Write Scratchpad in progress
+    STATE_CONVERT,      // Convert T issued
+    STATE_BUSY,         // Copy Scratchpad or Recall EEPROM issued
+    STATE_POWER,        // Read Power Supply issued
+};
+
+static DS18B20_SimBus * _sim(const OneWireBus * bus)
+{
+    // the bus instance is the first member of the simulated bus
+    return (DS18B20_SimBus *)bus;
+}
+
+static void _update_crc(DS18B20_SimDevice * device)
+{
+    device->scratchpad[8] = owb_crc8_bytes(0, device->scratchpad, 8);
+}
+
+static void _complete_conversion(DS18B20_SimDevice * device)
+{
+    // undefined low-order bits at lower resolutions hold whatever the device measured
+    uint16_t raw = (uint16_t)device->temperature;
+    device->scratchpad[0] = raw & 0xff;
+    device->scratchpad[1] = raw >> 8;
+
+    // https://github.com/cpetrich/counterfeit_DS18B20 - genuine devices update byte 6
+    device->scratchpad[6] = device->counterfeit ? 0x0c : (uint8_t)(0x10 - (raw & 0x0f));
+    _update_crc(device);
+
+    // the alarm compares bits 11 to 4 of the temperature with TH and TL
+    int8_t whole = (int8_t)(raw >> 4);
+    device->alarm = whole >= (int8_t)device->scratchpad[2] || whole <= (int8_t)device->scratchpad[3];
+    device->converting = false;
+}
+
+static void _update(DS18B20_SimBus * sim)
+{
+    // Complete any conversions that are due. Without the strong pullup, a parasitically powered
+    // device cannot draw its conversion current from the bus, so if the pullup has been off for
+    // longer than the datasheet allows at any time before completion, the device resets instead.
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        DS18B20_SimDevice * device = &sim->devices[i];
+        if (device->converting)
+        {
+            int64_t unpowered = device->conversion_start > sim->pullup_off_since
+                              ? device->conversion_start : sim->pullup_off_since;
+            if (device->parasitic && !sim->strong_pullup && now > unpowered + T_SPON_US
+                && unpowered + T_SPON_US < device->conversion_end)
+            {
+                ds18b20_sim_power_on_reset(device);
+            }
+            else if (now >= device->conversion_end)
+            {
+                _complete_conversion(device);
+            }
+        }
+    }
+}
+
+static uint32_t _conversion_time(const DS18B20_SimDevice * device)
+{
+    return device->conversion_us >> (12 - ds18b20_sim_resolution(device));
+}
+
+static void _select_all(DS18B20_SimBus * sim, bool alarm_only)
+{
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        sim->selected[i] = sim->devices[i].present && (!alarm_only || sim->devices[i].alarm);
+    }
+}
+
+static bool _any_selected(const DS18B20_SimBus * sim)
+{
+    bool any = false;
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        any = any || sim->selected[i];
+    }
+    return any;
+}
+
+static int _rom_bit(const DS18B20_SimDevice * device, size_t bit)
+{
+    return (device->rom_code.bytes[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void _rom_command(DS18B20_SimBus * sim, uint8_t command)
+{
+    sim->position = 0;
+    switch (command)
+    {
+        case OWB_ROM_SKIP:
+            _select_all(sim, false);
+            sim->state = STATE_FUNCTION;
+            break;
+        case OWB_ROM_MATCH:
+            sim->state = STATE_MATCH;
+            break;
+        case OWB_ROM_SEARCH:
+        case OWB_ROM_SEARCH_ALARM:
+            _select_all(sim, command == OWB_ROM_SEARCH_ALARM);
+            sim->search_phase = 0;
+            sim->state = STATE_SEARCH;
+            break;
+        default:
+            sim->state = STATE_IDLE;
+            break;
+    }
+}
+
+static void _match_byte(DS18B20_SimBus * sim, uint8_t data)
+{
+    sim->match[sim->position++] = data;
+    if (sim->position == sizeof(sim->match))
+    {
+        for (size_t i = 0; i < sim->count; ++i)
+        {
+            sim->selected[i] = sim->devices[i].present
+                            && memcmp(sim->devices[i].rom_code.bytes, sim->match, sizeof(sim->match)) == 0;
+        }
+        sim->position = 0;
+        sim->state = _any_selected(sim) ? STATE_FUNCTION : STATE_IDLE;
+    }
+}
+
+static void _function_command(DS18B20_SimBus * sim, uint8_t command)
+{
+    int64_t now = esp_timer_get_time();
+    sim->position = 0;
+    sim->state = STATE_IDLE;
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        DS18B20_SimDevice * device = &sim->devices[i];
+        if (!sim->selected[i])
+        {
+            continue;
+        }
+        switch (command)
+        {
+            case 0x44:  // Convert T
+                device->converting = true;
+                device->conversion_start = now;
+                device->conversion_end = now + _conversion_time(device);
+                sim->state = STATE_CONVERT;
+                break;
+            case 0xBE:  // Read Scratchpad
+                sim->corrupt = device->crc_faults > 0;
+                if (sim->corrupt)
+                {
+                    --device->crc_faults;
+                }
+                sim->state = STATE_READ;
+                break;
+            case 0x4E:  // Write Scratchpad
+                sim->state = STATE_WRITE;
+                break;
+            case 0x48:  // Copy Scratchpad
+                memcpy(device->eeprom, &device->scratchpad[2], sizeof(device->eeprom));
+                sim->busy_until = now + T_COPY_US;
+                sim->state = STATE_BUSY;
+                break;
+            case 0xB8:  // Recall EEPROM
+                memcpy(&device->scratchpad[2], device->eeprom, sizeof(device->eeprom));
+                _update_crc(device);
+                sim->busy_until = now + T_RECALL_US;
+                sim->state = STATE_BUSY;
+                break;
+            case 0xB4:  // Read Power Supply
+                sim->state = STATE_POWER;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void _write_scratchpad_byte(DS18B20_SimBus * sim, uint8_t data)
+{
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        if (sim->selected[i])
+        {
+            // configuration bit 7 is read-only zero, bits 0 to 4 read-only ones
+            DS18B20_SimDevice * device = &sim->devices[i];
+            device->scratchpad[2 + sim->position] = (sim->position == 2) ? ((data & 0x60) | 0x1f) : data;
+            _update_crc(device);
+        }
+    }
+    if (++sim->position == 3)
+    {
+        sim->state = STATE_IDLE;
+    }
+}
+
+static void _write_byte(DS18B20_SimBus * sim, uint8_t data)
+{
+    switch (sim->state)
+    {
+        case STATE_ROM:
+            _rom_command(sim, data);
+            break;
+        case STATE_MATCH:
+            _match_byte(sim, data);
+            break;
+        case STATE_FUNCTION:
+            _function_command(sim, data);
+            break;
+        case STATE_WRITE:
+            _write_scratchpad_byte(sim, data);
+            break;
+        default:
+            // no device is listening
+            break;
+    }
+}
+
+static uint8_t _read_scratchpad_byte(DS18B20_SimBus * sim)
+{
+    uint8_t data = 0xff;
+    if (sim->position < sizeof(sim->devices[0].scratchpad))
+    {
+        for (size_t i = 0; i < sim->count; ++i)
+        {
+            if (sim->selected[i])
+            {
+                data &= sim->devices[i].scratchpad[sim->position];
+            }
+        }
+        if (sim->corrupt && sim->position == 0)
+        {
+            data ^= 0x01;
+        }
+        ++sim->position;
+    }
+    return data;
+}
+
+static uint8_t _read_slot(DS18B20_SimBus * sim)
+{
+    // an idle bus reads as 1, and any responding device can pull it to 0
+    int64_t now = esp_timer_get_time();
+    uint8_t bit = 1;
+    switch (sim->state)
+    {
+        case STATE_CONVERT:
+            for (size_t i = 0; i < sim->count; ++i)
+            {
+                if (sim->selected[i] && sim->devices[i].converting)
+                {
+                    bit = 0;
+                }
+            }
+            break;
+        case STATE_BUSY:
+            bit = now >= sim->busy_until;
+            break;
+        case STATE_POWER:
+            for (size_t i = 0; i < sim->count; ++i)
+            {
+                if (sim->selected[i] && sim->devices[i].parasitic)
+                {
+                    bit = 0;
+                }
+            }
+            break;
+        case STATE_SEARCH:
+            if (sim->search_phase < 2)
+            {
+                // each device sends its ROM bit, then its complement
+                for (size_t i = 0; i < sim->count; ++i)
+                {
+                    if (sim->selected[i])
+                    {
+                        bit &= _rom_bit(&sim->devices[i], sim->position) ^ sim->search_phase;
+                    }
+                }
+                ++sim->search_phase;
+            }
+            break;
+        case STATE_READ:
+            // only whole-byte reads of the scratchpad are supported
+        default:
+            break;
+    }
+    return bit;
+}
+
+static void _write_slot(DS18B20_SimBus * sim, uint8_t bit)
+{
+    if (sim->state == STATE_SEARCH && sim->search_phase == 2)
+    {
+        // devices whose ROM bit differs from the chosen direction drop out of the search
+        for (size_t i = 0; i < sim->count; ++i)
+        {
+            if (sim->selected[i] && _rom_bit(&sim->devices[i], sim->position) != (bit & 1))
+            {
+                sim->selected[i] = false;
+            }
+        }
+        sim->search_phase = 0;
+        if (++sim->position == 64)
+        {
+            // the device found is now addressed
+            sim->position = 0;
+            sim->state = _any_selected(sim) ? STATE_FUNCTION : STATE_IDLE;
+        }
+    }
+}
+
+void ds18b20_sim_init(DS18B20_SimBus * sim, bool parasitic_power)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->bus.use_parasitic_power = parasitic_power;
+    sim->bus.strong_pullup_gpio = GPIO_NUM_NC;
+    sim->state = STATE_IDLE;
+}
+
+DS18B20_SimDevice * ds18b20_sim_add_device(DS18B20_SimBus * sim, uint64_t serial, float temperature)
+{
+    DS18B20_SimDevice * device = NULL;
+    if (sim->count < DS18B20_SIM_MAX_DEVICES)
+    {
+        device = &sim->devices[sim->count++];
+        memset(device, 0, sizeof(*device));
+        device->rom_code.fields.family[0] = 0x28;
+        for (size_t i = 0; i < sizeof(device->rom_code.fields.serial_number); ++i)
+        {
+            device->rom_code.fields.serial_number[i] = (serial >> (8 * i)) & 0xff;
+        }
+        device->rom_code.fields.crc[0] = owb_crc8_bytes(0, device->rom_code.bytes, 7);
+        device->conversion_us = DS18B20_SIM_DEFAULT_CONVERSION_US;
+        device->present = true;
+        device->parasitic = sim->bus.use_parasitic_power;
+        device->eeprom[0] = DEFAULT_TH;
+        device->eeprom[1] = DEFAULT_TL;
+        device->eeprom[2] = DEFAULT_CONFIG;
+        ds18b20_sim_set_temperature(device, temperature);
+        ds18b20_sim_power_on_reset(device);
+    }
+    return device;
+}
+
+void ds18b20_sim_set_temperature(DS18B20_SimDevice * device, float temperature)
+{
+    device->temperature = (int16_t)(temperature * 16.0f);
+}
+
+void ds18b20_sim_power_on_reset(DS18B20_SimDevice * device)
+{
+    static const uint8_t power_on[] = { 0x50, 0x05 };
+    memcpy(&device->scratchpad[0], power_on, sizeof(power_on));
+    memcpy(&device->scratchpad[2], device->eeprom, sizeof(device->eeprom));
+    device->scratchpad[5] = 0xff;
+    device->scratchpad[6] = 0x0c;
+    device->scratchpad[7] = 0x10;
+    _update_crc(device);
+    device->converting = false;
+    device->alarm = false;
+}
+
+int ds18b20_sim_resolution(const DS18B20_SimDevice * device)
+{
+    return ((device->scratchpad[4] >> 5) & 0x03) + 9;
+}
+
+owb_status owb_reset(const OneWireBus * bus, bool * is_present)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    host_clock_advance(T_RESET_US);
+    ++sim->resets;
+
+    bool present = false;
+    for (size_t i = 0; i < sim->count; ++i)
+    {
+        present = present || sim->devices[i].present;
+    }
+    sim->state = present ? STATE_ROM : STATE_IDLE;
+    sim->position = 0;
+    if (is_present)
+    {
+        *is_present = present;
+    }
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_read_bit(const OneWireBus * bus, uint8_t * out)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    host_clock_advance(T_SLOT_US);
+    *out = _read_slot(sim);
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_read_byte(const OneWireBus * bus, uint8_t * out)
+{
+    return owb_read_bytes(bus, out, 1);
+}
+
+owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, unsigned int len)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    for (unsigned int i = 0; i < len; ++i)
+    {
+        host_clock_advance(8 * T_SLOT_US);
+        buffer[i] = (sim->state == STATE_READ) ? _read_scratchpad_byte(sim) : 0xff;
+    }
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_write_bit(const OneWireBus * bus, uint8_t bit)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    host_clock_advance(T_SLOT_US);
+    _write_slot(sim, bit);
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_write_byte(const OneWireBus * bus, uint8_t data)
+{
+    return owb_write_bytes(bus, &data, 1);
+}
+
+owb_status owb_write_bytes(const OneWireBus * bus, const uint8_t * buffer, int len)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    for (int i = 0; i < len; ++i)
+    {
+        host_clock_advance(8 * T_SLOT_US);
+        _write_byte(sim, buffer[i]);
+    }
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_write_rom_code(const OneWireBus * bus, OneWireBus_ROMCode rom_code)
+{
+    return owb_write_bytes(bus, rom_code.bytes, sizeof(rom_code.bytes));
+}
+
+owb_status owb_set_strong_pullup(const OneWireBus * bus, bool enable)
+{
+    DS18B20_SimBus * sim = _sim(bus);
+    _update(sim);
+    if (sim->strong_pullup && !enable)
+    {
+        sim->pullup_off_since = esp_timer_get_time();
+    }
+    sim->strong_pullup = enable;
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_use_crc(OneWireBus * bus, bool use_crc)
+{
+    bus->use_crc = use_crc;
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_use_parasitic_power(OneWireBus * bus, bool use_parasitic_power)
+{
+    // only changes how the component waits; the power supply of each device is unchanged
+    bus->use_parasitic_power = use_parasitic_power;
+    return OWB_STATUS_OK;
+}
+
+static bool _search(const OneWireBus * bus, OneWireBus_SearchState * state)
+{
+    // 1-Wire search algorithm (Maxim Application Note 187), as implemented by esp32-owb
+    bool found = false;
+    bool present = false;
+    if (!state->last_device_flag)
+    {
+        owb_reset(bus, &present);
+    }
+
+    if (present)
+    {
+        int id_bit_number = 1;
+        int last_zero = 0;
+        owb_write_byte(bus, OWB_ROM_SEARCH);
+        while (id_bit_number <= 64)
+        {
+            uint8_t id_bit = 0;
+            uint8_t cmp_id_bit = 0;
+            owb_read_bit(bus, &id_bit);
+            owb_read_bit(bus, &cmp_id_bit);
+            if (id_bit && cmp_id_bit)
+            {
+                break;
+            }
+
+            int byte_number = (id_bit_number - 1) / 8;
+            uint8_t byte_mask = 1 << ((id_bit_number - 1) % 8);
+            uint8_t direction = id_bit;
+            if (id_bit == cmp_id_bit)
+            {
+                if (id_bit_number < state->last_discrepancy)
+                {
+                    direction = (state->rom_code.bytes[byte_number] & byte_mask) ? 1 : 0;
+                }
+                else
+                {
+                    direction = (id_bit_number == state->last_discrepancy);
+                }
+                if (direction == 0)
+                {
+                    last_zero = id_bit_number;
+                }
+            }
+
+            if (direction)
+            {
+                state->rom_code.bytes[byte_number] |= byte_mask;
+            }
+            else
+            {
+                state->rom_code.bytes[byte_number] &= ~byte_mask;
+            }
+            owb_write_bit(bus, direction);
+            ++id_bit_number;
+        }
+
+        if (id_bit_number > 64 && owb_crc8_bytes(0, state->rom_code.bytes, sizeof(state->rom_code.bytes)) == 0)
+        {
+            state->last_discrepancy = last_zero;
+            state->last_device_flag = (last_zero == 0);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        state->last_discrepancy = 0;
+        state->last_device_flag = true;
+    }
+    return found;
+}
+
+owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool * found_device)
+{
+    memset(state, 0, sizeof(*state));
+    *found_device = _search(bus, state);
+    return OWB_STATUS_OK;
+}
+
+owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool * found_device)
+{
+    *found_device = _search(bus, state);
+    return OWB_STATUS_OK;
+}
+
+uint8_t owb_crc8_byte(uint8_t crc, uint8_t data)
+{
+    // Dallas/Maxim CRC8, polynomial x^8 + x^5 + x^4 + 1
+    crc ^= data;
+    for (int i = 0; i < 8; ++i)
+    {
+        crc = (crc & 1) ? (crc >> 1) ^ 0x8c : (crc >> 1);
+    }
+    return crc;
+}
+
+uint8_t owb_crc8_bytes(uint8_t crc, const uint8_t * data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc = owb_crc8_byte(crc, data[i]);
+    }
+    return crc;
+}
@@ -0,0 +1,148 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file ds18b20_sim.h
+ * @brief Simulated 1-Wire bus of DS18B20 devices, for host builds.
+ *
+ * The simulated bus implements the esp32-owb functions used by the component, and responds
+ * to the DS18B20 ROM and function commands at the level of bytes and read/write slots.
+ * Each transfer advances the simulated clock by its standard-speed duration, and conversions
+ * take a configurable time, so that both the results and the timing of the component can be
+ * checked without hardware.
+ *
+ * Faults can be injected per device: CRC errors, missing presence pulses, power-on resets,
+ * and counterfeit devices whose scratchpad cannot distinguish a genuine 85 degree reading
+ * from the power-on value. On a parasitically powered bus, a device whose strong pullup is
+ * released before its conversion completes loses power and resets.
+ */
+
+#ifndef DS18B20_SIM_H
+#define DS18B20_SIM_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "owb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS18B20_SIM_MAX_DEVICES 16                    ///< Maximum number of devices on a simulated bus
+#define DS18B20_SIM_DEFAULT_CONVERSION_US 600000      ///< Default 12-bit conversion time, shorter than the datasheet maximum as is typical
+
+/**
+ * @brief Structure containing the state of a single simulated device.
+ *
+ * Members above the internal state may be changed by the test at any time.
+ */
+typedef struct
+{
+    OneWireBus_ROMCode rom_code;    ///< ROM code, with a valid CRC
+    int16_t temperature;            ///< Temperature latched by the next conversion, in 1/16 degrees Celsius
+    uint32_t conversion_us;         ///< Conversion time at 12-bit resolution, halved for each bit less
+    bool present;                   ///< False if the device does not respond to a reset
+    bool parasitic;                 ///< True if the device is parasitically powered
+    bool counterfeit;               ///< True if scratchpad byte 6 always reads 0x0c, as on some clones
+    unsigned int crc_faults;        ///< Number of subsequent scratchpad reads to corrupt
+
+    // internal state
+    uint8_t scratchpad[9];          ///< Scratchpad, including CRC
+    uint8_t eeprom[3];              ///< TH, TL and configuration EEPROM
+    bool converting;                ///< True while a conversion is in progress
+    bool alarm;                     ///< Alarm flag, from the last conversion
+    int64_t conversion_start;       ///< Time at which the conversion in progress started, in microseconds
+    int64_t conversion_end;         ///< Time at which the conversion in progress completes, in microseconds
+} DS18B20_SimDevice;
+
+/**
+ * @brief Structure containing the state of a simulated bus.
+ */
+typedef struct
+{
+    OneWireBus bus;                 ///< Bus instance passed to the component; must be the first member
+    DS18B20_SimDevice devices[DS18B20_SIM_MAX_DEVICES];  ///< Devices on the bus
+    size_t count;                   ///< Number of entries in devices
+    bool strong_pullup;             ///< True while the strong pullup is enabled
+    unsigned int resets;            ///< Number of reset pulses issued
+    int64_t pullup_off_since;       ///< Time at which the strong pullup was last disabled, in microseconds
+
+    // internal state
+    int state;                      ///< Protocol state
+    bool selected[DS18B20_SIM_MAX_DEVICES];  ///< Devices addressed by the last ROM command
+    size_t position;                ///< Byte or bit position within the current command
+    uint8_t match[8];               ///< ROM code received by Match ROM
+    bool corrupt;                   ///< True if the scratchpad read in progress is corrupted
+    int search_phase;               ///< Slot within the current search bit: read, read complement, write
+    int64_t busy_until;             ///< Time until which an EEPROM operation is in progress, in microseconds
+} DS18B20_SimBus;
+
+/**
+ * @brief Initialise a simulated bus with no devices.
+ * @param[in] sim Pointer to simulated bus instance.
+ * @param[in] parasitic_power True if the component should treat the bus as parasitically powered.
+ */
+void ds18b20_sim_init(DS18B20_SimBus * sim, bool parasitic_power);
+
+/**
+ * @brief Add a device to a simulated bus, with factory defaults.
+ *
+ * The device is in its power-on state: 12-bit resolution, 85 degree power-on value in the scratchpad,
+ * and no alarm.
+ * @param[in] sim Pointer to simulated bus instance.
+ * @param[in] serial Serial number, of which the lower 48 bits are used.
+ * @param[in] temperature Temperature latched by conversions, in degrees Celsius.
+ * @return Pointer to the new device, or NULL if the bus is full.
+ */
+DS18B20_SimDevice * ds18b20_sim_add_device(DS18B20_SimBus * sim, uint64_t serial, float temperature);
+
+/**
+ * @brief Set the temperature latched by subsequent conversions.
+ * @param[in] device Pointer to simulated device.
+ * @param[in] temperature Temperature, in degrees Celsius; rounded toward zero to 1/16 degree.
+ */
+void ds18b20_sim_set_temperature(DS18B20_SimDevice * device, float temperature);
+
+/**
+ * @brief Reset a device as if it had lost power.
+ *
+ * The scratchpad is reloaded from EEPROM and holds the 85 degree power-on value.
+ * @param[in] device Pointer to simulated device.
+ */
+void ds18b20_sim_power_on_reset(DS18B20_SimDevice * device);
+
+/**
+ * @brief Return the resolution currently configured in a device.
+ * @param[in] device Pointer to simulated device.
+ * @return Resolution, from 9 to 12 bits.
+ */
+int ds18b20_sim_resolution(const DS18B20_SimDevice * device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DS18B20_SIM_H
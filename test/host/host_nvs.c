@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file host_nvs.c
+ *
+ * Blobs are kept in a fixed array, keyed by handle and name, and are lost when the test exits.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nvs.h"
+
+#define MAX_BLOBS 8
+#define MAX_KEY_LENGTH 15   // as on the target
+
+typedef struct
+{
+    nvs_handle_t handle;
+    char key[MAX_KEY_LENGTH + 1];
+    void * value;
+    size_t length;
+} Blob;
+
+static Blob _blobs[MAX_BLOBS];
+
+static Blob * _find(nvs_handle_t handle, const char * key, bool create)
+{
+    Blob * unused = NULL;
+    for (int i = 0; i < MAX_BLOBS; ++i)
+    {
+        if (_blobs[i].value && _blobs[i].handle == handle && strcmp(_blobs[i].key, key) == 0)
+        {
+            return &_blobs[i];
+        }
+        if (!_blobs[i].value && unused == NULL)
+        {
+            unused = &_blobs[i];
+        }
+    }
+    return create ? unused : NULL;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char * key, const void * value, size_t length)
+{
+    if (key == NULL || strlen(key) > MAX_KEY_LENGTH || (value == NULL && length))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Blob * blob = _find(handle, key, true);
+    void * copy = malloc(length ? length : 1);
+    if (blob == NULL || copy == NULL)
+    {
+        free(copy);
+        return ESP_ERR_NO_MEM;
+    }
+    free(blob->value);
+    memcpy(copy, value, length);
+    blob->handle = handle;
+    strcpy(blob->key, key);
+    blob->value = copy;
+    blob->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char * key, void * out_value, size_t * length)
+{
+    if (key == NULL || length == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const Blob * blob = _find(handle, key, false);
+    if (blob == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != NULL)
+    {
+        // as on the target, a short buffer is an error rather than a partial read
+        if (*length < blob->length)
+        {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(out_value, blob->value, blob->length);
+    }
+    *length = blob->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
@@ -0,0 +1,609 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file host_rtos.c
+ *
+ * Tasks are cooperative coroutines on their own stacks: a task runs until it blocks, and
+ * then the next ready task runs. When no task is ready, the clock moves to the earliest
+ * timer expiry or task timeout. Every blocking call waits on the address of an object,
+ * and is woken to re-check its condition whenever that object is signalled.
+ *
+ * Tasks and timers are kept in fixed arrays and searched linearly, which is ample for
+ * the handful that the component creates at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+
+#include "host_rtos.h"
+
+#define MAX_TIMERS 8
+#define MAX_TASKS 8
+#define TASK_STACK_SIZE (256 * 1024)
+#define TICK_US ((int64_t)portTICK_PERIOD_MS * 1000)
+
+struct esp_timer
+{
+    esp_timer_cb_t callback;
+    void * arg;
+    int64_t expiry;
+    uint64_t period;
+    bool allocated;
+    bool active;
+};
+
+typedef enum
+{
+    TASK_UNUSED,
+    TASK_READY,
+    TASK_BLOCKED,
+    TASK_DELETED,
+} TaskState;
+
+struct HostTask
+{
+    ucontext_t context;
+    TaskFunction_t function;
+    void * parameter;
+    void * stack;
+    TaskState state;
+    const void * waiting;   // object the task is blocked on, or NULL for a plain delay
+    int64_t wake;           // time at which a blocked task times out, or INT64_MAX
+    uint32_t notifications;
+};
+
+typedef enum
+{
+    SEMAPHORE_BINARY,
+    SEMAPHORE_MUTEX,
+    SEMAPHORE_RECURSIVE_MUTEX,
+} SemaphoreType;
+
+struct HostSemaphore
+{
+    SemaphoreType type;
+    UBaseType_t count;
+    TaskHandle_t owner;
+    UBaseType_t depth;
+};
+
+struct HostQueue
+{
+    uint8_t * items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static int64_t _now;
+static struct esp_timer _timers[MAX_TIMERS];
+static struct HostTask _tasks[MAX_TASKS] = { [0] = { .state = TASK_READY } };   // the first task is main()
+static struct HostTask * _current = &_tasks[0];
+
+static struct esp_timer * _next_timer(void)
+{
+    struct esp_timer * next = NULL;
+    for (int i = 0; i < MAX_TIMERS; ++i)
+    {
+        if (_timers[i].active && (next == NULL || _timers[i].expiry < next->expiry))
+        {
+            next = &_timers[i];
+        }
+    }
+    return next;
+}
+
+static void _fire(struct esp_timer * timer)
+{
+    if (timer->period)
+    {
+        timer->expiry += timer->period;
+    }
+    else
+    {
+        timer->active = false;
+    }
+    timer->callback(timer->arg);
+}
+
+static void _wake_timeouts(void)
+{
+    for (int i = 0; i < MAX_TASKS; ++i)
+    {
+        if (_tasks[i].state == TASK_BLOCKED && _tasks[i].wake <= _now)
+        {
+            _tasks[i].state = TASK_READY;
+        }
+    }
+}
+
+static void _run_until(int64_t time)
+{
+    // run every callback due by time, in order, then move the clock to time
+    struct esp_timer * timer = NULL;
+    while ((timer = _next_timer()) != NULL && timer->expiry <= time)
+    {
+        if (timer->expiry > _now)
+        {
+            _now = timer->expiry;
+        }
+        _fire(timer);
+    }
+    if (time > _now)
+    {
+        _now = time;
+    }
+    _wake_timeouts();
+}
+
+static struct HostTask * _next_ready(void)
+{
+    // round robin, starting after the current task so that a yield lets others run
+    int current = (int)(_current - _tasks);
+    for (int i = 1; i <= MAX_TASKS; ++i)
+    {
+        struct HostTask * task = &_tasks[(current + i) % MAX_TASKS];
+        if (task->state == TASK_READY)
+        {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void _schedule(void)
+{
+    struct HostTask * next = NULL;
+    while ((next = _next_ready()) == NULL)
+    {
+        // nothing can run until the clock moves to the next timer or timeout
+        int64_t time = INT64_MAX;
+        struct esp_timer * timer = _next_timer();
+        if (timer != NULL)
+        {
+            time = timer->expiry;
+        }
+        for (int i = 0; i < MAX_TASKS; ++i)
+        {
+            if (_tasks[i].state == TASK_BLOCKED && _tasks[i].wake < time)
+            {
+                time = _tasks[i].wake;
+            }
+        }
+        if (time == INT64_MAX)
+        {
+            fprintf(stderr, "host rtos: deadlock at %lld us, every task is blocked forever\n", (long long)_now);
+            abort();
+        }
+        _run_until(time);
+    }
+
+    if (next != _current)
+    {
+        struct HostTask * previous = _current;
+        _current = next;
+        swapcontext(&previous->context, &next->context);
+    }
+}
+
+static void _block(const void * object, int64_t deadline)
+{
+    _current->state = TASK_BLOCKED;
+    _current->waiting = object;
+    _current->wake = deadline;
+    _schedule();
+}
+
+static void _signal(const void * object)
+{
+    for (int i = 0; i < MAX_TASKS; ++i)
+    {
+        if (_tasks[i].state == TASK_BLOCKED && _tasks[i].waiting == object)
+        {
+            _tasks[i].state = TASK_READY;
+        }
+    }
+}
+
+static int64_t _deadline(TickType_t ticks_to_wait)
+{
+    return ticks_to_wait == portMAX_DELAY ? INT64_MAX : _now + ticks_to_wait * TICK_US;
+}
+
+static void _task_entry(void)
+{
+    _current->function(_current->parameter);
+    fprintf(stderr, "host rtos: task function returned\n");
+    abort();
+}
+
+void host_clock_advance(uint32_t us)
+{
+    _now += us;
+}
+
+int host_timer_count(void)
+{
+    int count = 0;
+    for (int i = 0; i < MAX_TIMERS; ++i)
+    {
+        count += _timers[i].allocated;
+    }
+    return count;
+}
+
+int host_task_count(void)
+{
+    int count = 0;
+    for (int i = 0; i < MAX_TASKS; ++i)
+    {
+        count += _tasks[i].state == TASK_READY || _tasks[i].state == TASK_BLOCKED;
+    }
+    return count;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stack_depth,
+                                   void * parameter, UBaseType_t priority, TaskHandle_t * created, BaseType_t core_id)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    (void)core_id;
+    for (int i = 1; i < MAX_TASKS; ++i)
+    {
+        struct HostTask * task = &_tasks[i];
+        if (task->state == TASK_UNUSED || task->state == TASK_DELETED)
+        {
+            // a deleted task's stack is only released here, as it cannot free its own
+            free(task->stack);
+            memset(task, 0, sizeof(*task));
+            task->stack = malloc(TASK_STACK_SIZE);
+            if (task->stack == NULL)
+            {
+                return pdFAIL;
+            }
+            getcontext(&task->context);
+            task->context.uc_stack.ss_sp = task->stack;
+            task->context.uc_stack.ss_size = TASK_STACK_SIZE;
+            task->context.uc_link = NULL;
+            makecontext(&task->context, _task_entry, 0);
+            task->function = function;
+            task->parameter = parameter;
+            task->state = TASK_READY;
+            if (created)
+            {
+                *created = task;
+            }
+            return pdPASS;
+        }
+    }
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task != NULL && task != _current)
+    {
+        fprintf(stderr, "host rtos: only a task may delete itself\n");
+        abort();
+    }
+    _current->state = TASK_DELETED;
+    _schedule();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    int64_t deadline = _now + ticks * TICK_US;
+    while (_now < deadline)
+    {
+        _block(NULL, deadline);
+    }
+}
+
+void vTaskDelayUntil(TickType_t * previous_wake_time, TickType_t increment)
+{
+    *previous_wake_time += increment;
+    int64_t deadline = (int64_t)*previous_wake_time * TICK_US;
+    while (_now < deadline)
+    {
+        _block(NULL, deadline);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(_now / TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return _current;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    ++task->notifications;
+    _signal(&task->notifications);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    int64_t deadline = _deadline(ticks_to_wait);
+    while (_current->notifications == 0 && _now < deadline)
+    {
+        _block(&_current->notifications, deadline);
+    }
+
+    uint32_t value = _current->notifications;
+    if (value)
+    {
+        _current->notifications = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+static SemaphoreHandle_t _create_semaphore(SemaphoreType type, UBaseType_t count)
+{
+    SemaphoreHandle_t semaphore = calloc(1, sizeof(struct HostSemaphore));
+    if (semaphore)
+    {
+        semaphore->type = type;
+        semaphore->count = count;
+    }
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return _create_semaphore(SEMAPHORE_BINARY, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return _create_semaphore(SEMAPHORE_MUTEX, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return _create_semaphore(SEMAPHORE_RECURSIVE_MUTEX, 1);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+    int64_t deadline = _deadline(ticks_to_wait);
+    while (semaphore->count == 0)
+    {
+        if (_now >= deadline)
+        {
+            return pdFALSE;
+        }
+        _block(semaphore, deadline);
+    }
+    --semaphore->count;
+    semaphore->owner = _current;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    if (semaphore->type != SEMAPHORE_BINARY && semaphore->owner != _current)
+    {
+        fprintf(stderr, "xSemaphoreGive: mutex %p is not held by this task\n", (void *)semaphore);
+        abort();
+    }
+    if (semaphore->count)
+    {
+        return pdFALSE;
+    }
+    semaphore->count = 1;
+    semaphore->owner = NULL;
+    _signal(semaphore);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks_to_wait)
+{
+    if (mutex->owner == _current && mutex->depth)
+    {
+        ++mutex->depth;
+        return pdTRUE;
+    }
+    if (xSemaphoreTake(mutex, ticks_to_wait) != pdTRUE)
+    {
+        return pdFALSE;
+    }
+    mutex->depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    if (mutex->owner != _current || mutex->depth == 0)
+    {
+        fprintf(stderr, "xSemaphoreGiveRecursive: mutex %p is not held by this task\n", (void *)mutex);
+        abort();
+    }
+    if (--mutex->depth == 0)
+    {
+        xSemaphoreGive(mutex);
+    }
+    return pdTRUE;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t mutex)
+{
+    return mutex->type != SEMAPHORE_BINARY ? mutex->owner : NULL;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(struct HostQueue) + length * item_size);
+    if (queue)
+    {
+        queue->items = (uint8_t *)(queue + 1);
+        queue->length = length;
+        queue->item_size = item_size;
+    }
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t ticks_to_wait)
+{
+    int64_t deadline = _deadline(ticks_to_wait);
+    while (queue->count == queue->length)
+    {
+        if (_now >= deadline)
+        {
+            return pdFALSE;
+        }
+        _block(queue, deadline);
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    ++queue->count;
+    _signal(queue);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t ticks_to_wait)
+{
+    int64_t deadline = _deadline(ticks_to_wait);
+    while (queue->count == 0)
+    {
+        if (_now >= deadline)
+        {
+            return pdFALSE;
+        }
+        _block(queue, deadline);
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    --queue->count;
+    _signal(queue);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return _now;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t * args, esp_timer_handle_t * timer)
+{
+    if (args == NULL || args->callback == NULL || timer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < MAX_TIMERS; ++i)
+    {
+        if (!_timers[i].allocated)
+        {
+            _timers[i] = (struct esp_timer){ .callback = args->callback, .arg = args->arg, .allocated = true };
+            *timer = &_timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->expiry = _now + (int64_t)timeout_us;
+    timer->period = 0;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->expiry = _now + (int64_t)period_us;
+    timer->period = period_us;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->allocated = false;
+    return ESP_OK;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    _run_until(_now + us);
+}
@@ -0,0 +1,56 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file host_rtos.h
+ * @brief Simulated clock behind the host build of FreeRTOS, esp_timer and esp_rom_delay_us().
+ *
+ * Tasks are cooperative: each runs until it blocks. Time only moves when every task is
+ * blocked: the clock moves to the earliest wake time, running any timer callbacks due on
+ * the way, while bus transfers simply add their duration, as if timer callbacks and other
+ * tasks were held off until the transfer completes.
+ */
+
+#ifndef DS18B20_HOST_RTOS_H
+#define DS18B20_HOST_RTOS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Advance the simulated clock without running timer callbacks.
+ * @param[in] us Duration, in microseconds.
+ */
+void host_clock_advance(uint32_t us);
+
+/**
+ * @brief Return the number of esp_timer instances currently allocated, to detect leaks.
+ */
+int host_timer_count(void);
+
+/**
+ * @brief Return the number of tasks that have been created and not deleted, including main().
+ */
+int host_task_count(void);
+
+#endif  // DS18B20_HOST_RTOS_H
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file host_test.h
+ * @brief Minimal test harness for the host build: each test is a function, failures are counted.
+ */
+
+#ifndef DS18B20_HOST_TEST_H
+#define DS18B20_HOST_TEST_H
+
+#include <stdio.h>
+
+extern int host_test_failures;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++host_test_failures; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(expected, actual) \
+    do { \
+        long long expected_ = (long long)(expected); \
+        long long actual_ = (long long)(actual); \
+        if (expected_ != actual_) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+                    __FILE__, __LINE__, #expected, #actual, expected_, actual_); \
+            ++host_test_failures; \
+        } \
+    } while (0)
+
+#define RUN_TEST(test) \
+    do { \
+        int before_ = host_test_failures; \
+        test(); \
+        printf("%s %s\n", host_test_failures == before_ ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+#endif  // DS18B20_HOST_TEST_H
@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file owb.h
+ * @brief Host build: the subset of the esp32-owb interface used by this component.
+ *
+ * Declarations match esp32-owb, so the component compiles unchanged. On the host these
+ * functions are implemented by the simulated bus in ds18b20_sim.c.
+ */
+
+#ifndef DS18B20_HOST_OWB_H
+#define DS18B20_HOST_OWB_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+
+#define OWB_ROM_SEARCH        0xF0  ///< Perform Search ROM cycle to identify devices on the bus
+#define OWB_ROM_READ          0x33  ///< Read device ROM (single device on bus only)
+#define OWB_ROM_MATCH         0x55  ///< Address a specific device on the bus by ROM
+#define OWB_ROM_SKIP          0xCC  ///< Address all devices on the bus simultaneously
+#define OWB_ROM_SEARCH_ALARM  0xEC  ///< Address all devices on the bus with a set alarm flag
+
+#define OWB_ROM_CODE_STRING_LENGTH (17)  ///< Typical length of OneWire bus ROM ID as ASCII hex string, including null terminator
+
+struct owb_driver;
+
+/**
+ * @brief Structure containing 1-Wire bus information relevant to a single instance.
+ */
+typedef struct
+{
+    const struct _OneWireBus_Timing * timing;  ///< Pointer to timing information
+    bool use_crc;                              ///< True if CRC checks are to be used when retrieving information from a device on the bus
+    bool use_parasitic_power;                  ///< True if parasitic-powered devices are expected on the bus
+    gpio_num_t strong_pullup_gpio;             ///< Set if an external strong pull-up circuit is required
+    const struct owb_driver * driver;          ///< Pointer to hardware driver instance
+} OneWireBus;
+
+/**
+ * @brief Represents a 1-Wire ROM Code. This is a sequence of eight bytes, where
+ *        the first byte is the family number, then the following 6 bytes form the
+ *        serial number. The final byte is the CRC8 check byte.
+ */
+typedef union
+{
+    /// Provides access via field names
+    struct fields
+    {
+        uint8_t family[1];         ///< family identifier (1 byte, LSB - read/write first)
+        uint8_t serial_number[6];  ///< serial number (6 bytes)
+        uint8_t crc[1];            ///< CRC check byte (1 byte, MSB - read/write last)
+    } fields;
+
+    uint8_t bytes[8];              ///< Provides raw byte access
+} OneWireBus_ROMCode;
+
+/**
+ * @brief Represents the state of a device search on the 1-Wire bus.
+ */
+typedef struct
+{
+    OneWireBus_ROMCode rom_code;   ///< Device ROM code
+    int last_discrepancy;          ///< Bit index that identifies from which bit the next search discrepancy check should start
+    int last_family_discrepancy;   ///< Bit index that identifies the last discrepancy within the first 8-bit family code of the ROM code
+    int last_device_flag;          ///< Flag to indicate previous search was the last device detected
+} OneWireBus_SearchState;
+
+/**
+ * @brief Represents the result of OWB API functions.
+ */
+typedef enum
+{
+    OWB_STATUS_NOT_SET = -1,           ///< A status value has not been set
+    OWB_STATUS_OK = 0,                 ///< Operation succeeded
+    OWB_STATUS_NOT_INITIALIZED,        ///< Function was passed an uninitialised variable
+    OWB_STATUS_PARAMETER_NULL,         ///< Function was passed a null pointer
+    OWB_STATUS_DEVICE_NOT_RESPONDING,  ///< No response received from the addressed device or devices
+    OWB_STATUS_CRC_FAILED,             ///< CRC failed on data received from a device or devices
+    OWB_STATUS_TOO_MANY_BITS,          ///< Attempt to write an incorrect number of bits to the One Wire Bus
+    OWB_STATUS_HW_ERROR                ///< A hardware error occurred
+} owb_status;
+
+owb_status owb_reset(const OneWireBus * bus, bool * is_present);
+owb_status owb_read_bit(const OneWireBus * bus, uint8_t * out);
+owb_status owb_read_byte(const OneWireBus * bus, uint8_t * out);
+owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, unsigned int len);
+owb_status owb_write_bit(const OneWireBus * bus, uint8_t bit);
+owb_status owb_write_byte(const OneWireBus * bus, uint8_t data);
+owb_status owb_write_bytes(const OneWireBus * bus, const uint8_t * buffer, int len);
+owb_status owb_write_rom_code(const OneWireBus * bus, OneWireBus_ROMCode rom_code);
+owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool * found_device);
+owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool * found_device);
+owb_status owb_set_strong_pullup(const OneWireBus * bus, bool enable);
+owb_status owb_use_crc(OneWireBus * bus, bool use_crc);
+owb_status owb_use_parasitic_power(OneWireBus * bus, bool use_parasitic_power);
+uint8_t owb_crc8_byte(uint8_t crc, uint8_t data);
+uint8_t owb_crc8_bytes(uint8_t crc, const uint8_t * data, size_t len);
+
+#endif  // DS18B20_HOST_OWB_H
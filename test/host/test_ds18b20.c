@@ -0,0 +1,537 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file test_ds18b20.c
+ * @brief Host tests of the device read paths, against the simulated bus.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include "ds18b20.h"
+#include "ds18b20_sim.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+int host_test_failures = 0;
+
+static DS18B20_SimBus sim;
+
+static void _init_solo(DS18B20_Info * info, bool use_crc, DS18B20_RESOLUTION resolution)
+{
+    ds18b20_init_solo(info, &sim.bus);
+    ds18b20_use_crc(info, use_crc);
+    CHECK(ds18b20_set_resolution(info, resolution));
+}
+
+static void test_read_solo(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 21.5f);
+
+    DS18B20_Info info;
+    _init_solo(&info, true, DS18B20_RESOLUTION_12_BIT);
+    CHECK_EQ(12, ds18b20_sim_resolution(device));
+
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_convert_and_read_temp(&info, &value));
+    CHECK(value == 21.5f);
+}
+
+static void test_read_masks_undefined_bits(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 25.0f + 7.0f / 16.0f);
+
+    DS18B20_Info info;
+    _init_solo(&info, false, DS18B20_RESOLUTION_9_BIT);
+    CHECK_EQ(9, ds18b20_sim_resolution(device));
+
+    int16_t raw = 0;
+    CHECK(ds18b20_convert(&info));
+    ds18b20_wait_for_conversion(&info);
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp_raw(&info, &raw));
+    CHECK_EQ(25 * 16, raw);
+}
+
+static void test_discover_and_read_all(void)
+{
+    static const float temperatures[] = { 18.0f, -10.125f, 30.5f, 0.0625f };
+    const size_t count = sizeof(temperatures) / sizeof(temperatures[0]);
+    ds18b20_sim_init(&sim, false);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // serials out of order, to check that the pool is sorted
+        ds18b20_sim_add_device(&sim, 0x100 - i, temperatures[i]);
+    }
+
+    DS18B20_Pool * pool = ds18b20_pool_create(8);
+    CHECK_EQ(count, ds18b20_discover(&sim.bus, pool, 8));
+    for (size_t i = 1; i < pool->count; ++i)
+    {
+        CHECK(memcmp(pool->devices[i - 1].rom_code.bytes, pool->devices[i].rom_code.bytes, 8) < 0);
+    }
+
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&pool->devices[0]);
+
+    float values[8] = {0};
+    DS18B20_ERROR errs[8] = {0};
+    CHECK_EQ(DS18B20_OK, ds18b20_pool_read_temp(pool, values, errs));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DS18B20_Info * info = ds18b20_pool_find(pool, sim.devices[i].rom_code);
+        CHECK(info != NULL);
+        if (info)
+        {
+            size_t index = info - pool->devices;
+            CHECK_EQ(DS18B20_OK, errs[index]);
+            CHECK(values[index] == temperatures[i]);
+        }
+    }
+    ds18b20_pool_free(&pool);
+}
+
+static void test_discover_other_families(void)
+{
+    // a device of another family, which must not count towards the limit nor trigger its warning
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * other = ds18b20_sim_add_device(&sim, 1, 0.0f);
+    other->rom_code.fields.family[0] = 0x10;
+    other->rom_code.fields.crc[0] = owb_crc8_bytes(0, other->rom_code.bytes, 7);
+    ds18b20_sim_add_device(&sim, 2, 21.0f);
+
+    DS18B20_Pool * pool = ds18b20_pool_create(2);
+    CHECK_EQ(1, ds18b20_discover(&sim.bus, pool, 1));
+    CHECK_EQ(DS18B20_FAMILY_CODE, pool->devices[0].rom_code.fields.family[0]);
+
+    // a second DS18B20 device beyond the limit is ignored
+    ds18b20_sim_add_device(&sim, 3, 22.0f);
+    CHECK_EQ(1, ds18b20_discover(&sim.bus, pool, 1));
+    CHECK_EQ(2, ds18b20_discover(&sim.bus, pool, 2));
+    ds18b20_pool_free(&pool);
+}
+
+static void test_crc_failure(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 20.0f);
+
+    DS18B20_Info info;
+    DS18B20_Stats stats;
+    _init_solo(&info, true, DS18B20_RESOLUTION_12_BIT);
+    ds18b20_use_stats(&info, &stats);
+    ds18b20_stats_reset(&stats);
+    CHECK(ds18b20_convert(&info));
+    ds18b20_wait_for_conversion(&info);
+
+    // without retries, the corrupted read is reported
+    float value = 0.0f;
+    device->crc_faults = 1;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_read_temp(&info, &value));
+    CHECK_EQ(1, stats.crc_failures);
+
+    // with a retry, the latched result is read again
+    ds18b20_set_retry_policy(&info, 1, 0, 100);
+    device->crc_faults = 1;
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp(&info, &value));
+    CHECK(value == 20.0f);
+    CHECK_EQ(2, stats.crc_failures);
+    CHECK_EQ(1, stats.retries);
+
+    // more faults than retries
+    device->crc_faults = 2;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_read_temp(&info, &value));
+    CHECK_EQ(0, device->crc_faults);
+}
+
+static void test_default_stats(void)
+{
+    ds18b20_sim_init(&sim, false);
+    ds18b20_sim_add_device(&sim, 1, 20.0f);
+    ds18b20_sim_add_device(&sim, 2, 21.0f);
+
+    // the bus transactions of initialisation and of bus-wide conversions are counted
+    DS18B20_Stats stats;
+    ds18b20_stats_reset(&stats);
+    ds18b20_use_default_stats(&stats);
+    DS18B20_Info info;
+    ds18b20_init(&info, &sim.bus, sim.devices[0].rom_code);
+    CHECK_EQ(1, stats.bus_time[DS18B20_BUS_OP_SCRATCHPAD_READ].count);
+
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&info);
+    CHECK_EQ(1, stats.bus_time[DS18B20_BUS_OP_CONVERT].count);
+    CHECK_EQ(1, stats.conversions);
+
+    // instances initialised afterwards, or re-initialised, have no counters attached
+    ds18b20_use_default_stats(NULL);
+    uint32_t resets = stats.resets;
+    ds18b20_init(&info, &sim.bus, sim.devices[0].rom_code);
+    ds18b20_convert_all(&sim.bus);
+    CHECK_EQ(resets, stats.resets);
+}
+
+static void test_batch_read_failure(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_Info infos[2];
+    DS18B20_Info * devices[2] = { &infos[0], &infos[1] };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        ds18b20_sim_add_device(&sim, i + 1, 21.0625f);
+        ds18b20_init(&infos[i], &sim.bus, sim.devices[i].rom_code);
+        ds18b20_use_crc(&infos[i], true);
+    }
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&infos[0]);
+
+    // a corrupted read reports the sentinel rather than the value it happened to hold
+    float values[2] = {0};
+    DS18B20_ERROR errs[2] = {0};
+    sim.devices[0].crc_faults = 1;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_read_temp_multi(devices, 2, values, errs));
+    CHECK_EQ(DS18B20_ERROR_CRC, errs[0]);
+    CHECK(values[0] == DS18B20_RAW_INVALID / 16.0f);
+    CHECK_EQ(DS18B20_OK, errs[1]);
+    CHECK(values[1] == 21.0625f);
+
+    int16_t raw[2] = {0};
+    sim.devices[1].crc_faults = 1;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_read_temp_raw_multi(devices, 2, raw, errs));
+    CHECK_EQ(DS18B20_OK, errs[0]);
+    CHECK_EQ(21 * 16 + 1, raw[0]);
+    CHECK_EQ(DS18B20_ERROR_CRC, errs[1]);
+    CHECK_EQ(DS18B20_RAW_INVALID, raw[1]);
+
+    sim.devices[0].crc_faults = 1;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_read_temp_raw_trusted(&infos[0], &raw[0]));
+    CHECK_EQ(DS18B20_RAW_INVALID, raw[0]);
+
+    // so does the power-on value
+    ds18b20_sim_power_on_reset(&sim.devices[0]);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_read_temp(&infos[0], &value));
+    CHECK(value == DS18B20_RAW_INVALID / 16.0f);
+}
+
+static void test_missing_device(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 20.0f);
+
+    DS18B20_Info info;
+    ds18b20_init_with_resolution(&info, &sim.bus, device->rom_code, DS18B20_RESOLUTION_12_BIT);
+    device->present = false;
+
+    float value = 0.0f;
+    CHECK(ds18b20_read_temp(&info, &value) != DS18B20_OK);
+}
+
+static void test_power_on_value(void)
+{
+    ds18b20_sim_init(&sim, false);
+    ds18b20_sim_add_device(&sim, 1, 22.0f);
+
+    // the scratchpad of a device that has never converted holds the power-on value
+    DS18B20_Info info;
+    _init_solo(&info, true, DS18B20_RESOLUTION_12_BIT);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_read_temp(&info, &value));
+}
+
+static void test_power_on_recovery(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 22.0f);
+
+    DS18B20_Info info;
+    _init_solo(&info, false, DS18B20_RESOLUTION_10_BIT);
+    ds18b20_use_power_on_recovery(&info, true);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_convert_and_read_temp(&info, &value));
+    CHECK(value == 22.0f);
+
+    // the device restarts with its EEPROM configuration, and the cached one is re-applied
+    ds18b20_sim_power_on_reset(device);
+    CHECK_EQ(12, ds18b20_sim_resolution(device));
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_read_temp(&info, &value));
+    CHECK_EQ(10, ds18b20_sim_resolution(device));
+
+    // recovery also starts a new conversion
+    ds18b20_wait_for_conversion(&info);
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp(&info, &value));
+    CHECK(value == 22.0f);
+}
+
+static void test_genuine_85_degrees(void)
+{
+    ds18b20_sim_init(&sim, false);
+    ds18b20_sim_add_device(&sim, 1, 85.0f);
+
+    // a genuine device updates scratchpad byte 6, so a real 85 degrees is accepted
+    DS18B20_Info info;
+    _init_solo(&info, true, DS18B20_RESOLUTION_12_BIT);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_convert_and_read_temp(&info, &value));
+    CHECK(value == 85.0f);
+}
+
+static void test_counterfeit_85_degrees(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 85.0f);
+    device->counterfeit = true;
+
+    // with byte 6 fixed at 0x0c, a real 85 degrees cannot be told from the power-on value
+    DS18B20_Info info;
+    _init_solo(&info, true, DS18B20_RESOLUTION_12_BIT);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_convert_and_read_temp(&info, &value));
+
+    ds18b20_sim_set_temperature(device, 84.9375f);
+    CHECK_EQ(DS18B20_OK, ds18b20_convert_and_read_temp(&info, &value));
+    CHECK(value == 84.9375f);
+}
+
+static void test_parasitic_power(void)
+{
+    ds18b20_sim_init(&sim, true);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 19.25f);
+
+    bool parasitic = false;
+    CHECK_EQ(DS18B20_OK, ds18b20_check_for_parasite_power(&sim.bus, &parasitic));
+    CHECK(parasitic);
+
+    // the strong pullup must be held for the whole conversion, or the device resets
+    DS18B20_Info info;
+    _init_solo(&info, true, DS18B20_RESOLUTION_11_BIT);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_convert_and_read_temp(&info, &value));
+    CHECK(value == 19.25f);
+    CHECK(!sim.strong_pullup);
+    CHECK_EQ(11, ds18b20_sim_resolution(device));
+}
+
+static void test_parasitic_shared_bus(void)
+{
+    ds18b20_sim_init(&sim, true);
+    ds18b20_sim_add_device(&sim, 1, 19.25f);
+    ds18b20_sim_add_device(&sim, 2, 20.5f);
+    SemaphoreHandle_t bus_lock = xSemaphoreCreateRecursiveMutex();
+
+    bool parasitic = false;
+    CHECK_EQ(DS18B20_OK, ds18b20_check_for_parasite_power_locked(&sim.bus, bus_lock, &parasitic));
+    CHECK(parasitic);
+
+    // discovery sets the lock on every device
+    DS18B20_Pool * pool = ds18b20_pool_create(2);
+    CHECK_EQ(2, ds18b20_discover_locked(&sim.bus, bus_lock, pool, 2));
+    CHECK(pool->devices[0].bus_lock == bus_lock);
+    CHECK(pool->devices[1].bus_lock == bus_lock);
+
+    // conversions are refused unless the caller holds the lock for the whole conversion
+    DS18B20_Info * info = &pool->devices[0];
+    CHECK(!ds18b20_convert(info));
+    CHECK(!ds18b20_convert_all_locked(&sim.bus, bus_lock));
+    CHECK(!sim.strong_pullup);
+
+    xSemaphoreTakeRecursive(bus_lock, portMAX_DELAY);
+    CHECK(ds18b20_convert(info));
+    CHECK(sim.strong_pullup);
+    ds18b20_wait_for_conversion(info);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp(info, &value));
+    CHECK(value == 19.25f);
+
+    CHECK(ds18b20_convert_all_locked(&sim.bus, bus_lock));
+    ds18b20_wait_for_conversion(info);
+    xSemaphoreGiveRecursive(bus_lock);
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp(&pool->devices[1], &value));
+    CHECK(value == 20.5f);
+
+    // the lock is released after each operation
+    CHECK(xSemaphoreGetMutexHolder(bus_lock) == NULL);
+    ds18b20_pool_free(&pool);
+    vSemaphoreDelete(bus_lock);
+}
+
+static void test_wait_for_conversion_units(void)
+{
+    // both wait paths report milliseconds
+    ds18b20_sim_init(&sim, true);
+    ds18b20_sim_add_device(&sim, 1, 20.0f);
+    DS18B20_Info info;
+    _init_solo(&info, false, DS18B20_RESOLUTION_12_BIT);
+    CHECK(ds18b20_convert(&info));
+    uint32_t elapsed = ds18b20_wait_for_conversion(&info);
+    CHECK(elapsed >= 750 && elapsed < 750 + portTICK_PERIOD_MS);
+
+    ds18b20_sim_init(&sim, false);
+    ds18b20_sim_add_device(&sim, 1, 20.0f);
+    _init_solo(&info, false, DS18B20_RESOLUTION_12_BIT);
+    CHECK(ds18b20_convert(&info));
+    elapsed = ds18b20_wait_for_conversion(&info);
+    CHECK(elapsed >= DS18B20_SIM_DEFAULT_CONVERSION_US / 1000 && elapsed < 750);
+}
+
+static void test_wait_precise(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * device = ds18b20_sim_add_device(&sim, 1, 20.0f);
+    device->conversion_us = 612345;
+
+    DS18B20_Info info;
+    _init_solo(&info, false, DS18B20_RESOLUTION_12_BIT);
+    CHECK(ds18b20_convert(&info));
+    uint32_t elapsed_us = 0;
+    CHECK_EQ(DS18B20_OK, ds18b20_wait_for_conversion_us(&info, 500, &elapsed_us));
+    CHECK(elapsed_us >= 612345 && elapsed_us < 612345 + 1000);
+    int timers = host_timer_count();
+
+    // a device that never completes times out after the allowed overtime
+    device->conversion_us = 2000000;
+    CHECK(ds18b20_convert(&info));
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_wait_for_conversion_us(&info, 500, &elapsed_us));
+    CHECK(elapsed_us >= ds18b20_get_timing(DS18B20_RESOLUTION_12_BIT)->timeout_us);
+
+    // the wait reuses its timer, and leaves the caller's task notifications alone
+    device->conversion_us = 612345;
+    xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    CHECK(ds18b20_convert(&info));
+    CHECK_EQ(DS18B20_OK, ds18b20_wait_for_conversion_us(&info, 500, &elapsed_us));
+    CHECK(elapsed_us >= 612345 && elapsed_us < 612345 + 1000);
+    CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, 0));
+    CHECK_EQ(timers, host_timer_count());
+}
+
+static void test_alarm_search(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_SimDevice * cold = ds18b20_sim_add_device(&sim, 1, 5.0f);
+    DS18B20_SimDevice * warm = ds18b20_sim_add_device(&sim, 2, 20.0f);
+    ds18b20_sim_add_device(&sim, 3, 40.0f);
+
+    DS18B20_Info infos[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        ds18b20_init(&infos[i], &sim.bus, sim.devices[i].rom_code);
+        CHECK(ds18b20_set_alarm(&infos[i], 30, 10));
+    }
+
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&infos[0]);
+
+    OneWireBus_ROMCode rom_codes[3];
+    size_t count = 0;
+    CHECK_EQ(DS18B20_OK, ds18b20_alarm_search(&sim.bus, rom_codes, 3, &count));
+    CHECK_EQ(2, count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        CHECK(memcmp(rom_codes[i].bytes, warm->rom_code.bytes, 8) != 0);
+    }
+    CHECK(cold->alarm && !warm->alarm);
+}
+
+static void test_configure_all(void)
+{
+    ds18b20_sim_init(&sim, false);
+    DS18B20_Info infos[3];
+    DS18B20_Info * devices[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        ds18b20_sim_add_device(&sim, i + 1, 20.0f);
+        ds18b20_init(&infos[i], &sim.bus, sim.devices[i].rom_code);
+        devices[i] = &infos[i];
+    }
+
+    DS18B20_ERROR errs[3] = { DS18B20_ERROR_UNKNOWN, DS18B20_ERROR_UNKNOWN, DS18B20_ERROR_UNKNOWN };
+    CHECK_EQ(DS18B20_OK, ds18b20_configure_all(devices, 3, DS18B20_RESOLUTION_10_BIT, 30, 10, true, errs));
+    for (size_t i = 0; i < 3; ++i)
+    {
+        CHECK_EQ(DS18B20_OK, errs[i]);
+        CHECK_EQ(10, ds18b20_sim_resolution(&sim.devices[i]));
+        CHECK_EQ(30, sim.devices[i].eeprom[0]);
+        CHECK_EQ(10, sim.devices[i].eeprom[1]);
+        CHECK_EQ(DS18B20_RESOLUTION_10_BIT, infos[i].resolution);
+    }
+
+    // the cached configuration is confirmed, so setting it again does not access the bus
+    int64_t before = esp_timer_get_time();
+    CHECK(ds18b20_set_resolution(&infos[1], DS18B20_RESOLUTION_10_BIT));
+    CHECK(ds18b20_set_alarm(&infos[2], 30, 10));
+    CHECK_EQ(before, esp_timer_get_time());
+
+    // a missing device fails verification, without affecting the others
+    sim.devices[1].present = false;
+    CHECK(ds18b20_configure_all(devices, 3, DS18B20_RESOLUTION_12_BIT, 40, 0, false, errs) != DS18B20_OK);
+    CHECK_EQ(DS18B20_OK, errs[0]);
+    CHECK(errs[1] != DS18B20_OK);
+    CHECK_EQ(DS18B20_OK, errs[2]);
+    CHECK_EQ(12, ds18b20_sim_resolution(&sim.devices[2]));
+    CHECK_EQ(30, sim.devices[2].eeprom[0]);
+    CHECK(!infos[1].config_valid);
+
+    // devices on another bus cannot be reached by the broadcast, so nothing is written
+    static DS18B20_SimBus other;
+    ds18b20_sim_init(&other, false);
+    ds18b20_sim_add_device(&other, 4, 20.0f);
+    DS18B20_Info elsewhere;
+    ds18b20_init(&elsewhere, &other.bus, other.devices[0].rom_code);
+    DS18B20_Info * mixed[2] = { &infos[0], &elsewhere };
+    CHECK_EQ(DS18B20_ERROR_ARGUMENT, ds18b20_configure_all(mixed, 2, DS18B20_RESOLUTION_9_BIT, 30, 10, false, NULL));
+    CHECK_EQ(12, ds18b20_sim_resolution(&sim.devices[0]));
+    CHECK_EQ(12, ds18b20_sim_resolution(&other.devices[0]));
+}
+
+int main(void)
+{
+    RUN_TEST(test_read_solo);
+    RUN_TEST(test_read_masks_undefined_bits);
+    RUN_TEST(test_discover_and_read_all);
+    RUN_TEST(test_discover_other_families);
+    RUN_TEST(test_crc_failure);
+    RUN_TEST(test_default_stats);
+    RUN_TEST(test_batch_read_failure);
+    RUN_TEST(test_missing_device);
+    RUN_TEST(test_power_on_value);
+    RUN_TEST(test_power_on_recovery);
+    RUN_TEST(test_genuine_85_degrees);
+    RUN_TEST(test_counterfeit_85_degrees);
+    RUN_TEST(test_parasitic_power);
+    RUN_TEST(test_parasitic_shared_bus);
+    RUN_TEST(test_wait_for_conversion_units);
+    RUN_TEST(test_wait_precise);
+    RUN_TEST(test_alarm_search);
+    RUN_TEST(test_configure_all);
+    return host_test_failures ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file test_ds18b20_sampler.c
+ * @brief Host tests of the sampler and manager tasks, against the simulated bus.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "ds18b20.h"
+#include "ds18b20_sampler.h"
+#include "ds18b20_manager.h"
+#include "ds18b20_sim.h"
+#include "host_rtos.h"
+#include "host_test.h"
+
+int host_test_failures = 0;
+
+#define COUNT 2
+#define PERIOD_MS 1000
+
+static DS18B20_SimBus sim;
+static DS18B20_Info infos[COUNT];
+static DS18B20_Info * devices[COUNT] = { &infos[0], &infos[1] };
+
+static void _setup(bool parasitic_power)
+{
+    ds18b20_sim_init(&sim, parasitic_power);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ds18b20_sim_add_device(&sim, i + 1, 20.0f + i);
+        ds18b20_init(&infos[i], &sim.bus, sim.devices[i].rom_code);
+        ds18b20_use_crc(&infos[i], true);
+        CHECK(ds18b20_set_resolution(&infos[i], DS18B20_RESOLUTION_12_BIT));
+    }
+}
+
+static DS18B20_SamplerConfig _config(void)
+{
+    DS18B20_SamplerConfig config = {
+        .bus = &sim.bus,
+        .devices = devices,
+        .count = COUNT,
+        .period_ms = PERIOD_MS,
+        .core_id = tskNO_AFFINITY,
+    };
+    return config;
+}
+
+static void test_sampler_create_delete(void)
+{
+    _setup(false);
+    DS18B20_SamplerConfig config = _config();
+    DS18B20_Sampler * sampler = ds18b20_sampler_create(&config);
+    CHECK(sampler != NULL);
+    CHECK_EQ(2, host_task_count());
+
+    // no sample is published before the first cycle completes
+    DS18B20_Sample sample = {0};
+    CHECK_EQ(DS18B20_OK, ds18b20_sampler_get(sampler, 0, &sample));
+    CHECK_EQ(DS18B20_ERROR_UNKNOWN, sample.error);
+
+    vTaskDelay(pdMS_TO_TICKS(PERIOD_MS * 3 + PERIOD_MS / 2));
+    CHECK(ds18b20_sampler_get_cycles(sampler) >= 3);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        CHECK_EQ(DS18B20_OK, ds18b20_sampler_get(sampler, i, &sample));
+        CHECK_EQ(DS18B20_OK, sample.error);
+        CHECK(sample.value == 20.0f + i);
+    }
+    CHECK(ds18b20_sampler_get(sampler, COUNT, &sample) != DS18B20_OK);
+
+    ds18b20_sampler_delete(&sampler);
+    CHECK(sampler == NULL);
+    CHECK_EQ(1, host_task_count());
+    CHECK_EQ(0, host_timer_count());
+}
+
+static void test_sampler_delete_with_pending_notification(void)
+{
+    _setup(false);
+    DS18B20_SamplerConfig config = _config();
+    DS18B20_Sampler * sampler = ds18b20_sampler_create(&config);
+    vTaskDelay(pdMS_TO_TICKS(PERIOD_MS / 2));
+
+    // a notification meant for something else must not cut the wait for the task short
+    xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    ds18b20_sampler_delete(&sampler);
+    CHECK_EQ(1, host_task_count());
+    CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, 0));
+}
+
+static void test_sampler_parasitic(void)
+{
+    _setup(true);
+    DS18B20_SamplerConfig config = _config();
+    DS18B20_Sampler * sampler = ds18b20_sampler_create(&config);
+    CHECK(sampler != NULL);
+
+    vTaskDelay(pdMS_TO_TICKS(PERIOD_MS * 2 + PERIOD_MS / 2));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        DS18B20_Sample sample = {0};
+        CHECK_EQ(DS18B20_OK, ds18b20_sampler_get(sampler, i, &sample));
+        CHECK_EQ(DS18B20_OK, sample.error);
+        CHECK(sample.value == 20.0f + i);
+    }
+    ds18b20_sampler_delete(&sampler);
+    CHECK(!sim.strong_pullup);
+}
+
+static void test_sampler_subscription(void)
+{
+    _setup(false);
+    DS18B20_SamplerConfig config = _config();
+    DS18B20_Sampler * sampler = ds18b20_sampler_create(&config);
+    QueueHandle_t queue = xQueueCreate(4, sizeof(DS18B20_SampleEvent));
+    DS18B20_Subscription subscription;
+    CHECK_EQ(DS18B20_OK, ds18b20_sampler_subscribe(sampler, &subscription, 1, 0.5f, NULL, NULL, queue));
+
+    // the first sample is always delivered, then only changes beyond the deadband
+    DS18B20_SampleEvent event = {0};
+    CHECK(xQueueReceive(queue, &event, pdMS_TO_TICKS(PERIOD_MS * 2)));
+    CHECK_EQ(1, event.index);
+    CHECK(event.sample.value == 21.0f);
+
+    ds18b20_sim_set_temperature(&sim.devices[1], 21.25f);
+    CHECK(!xQueueReceive(queue, &event, pdMS_TO_TICKS(PERIOD_MS * 3)));
+    ds18b20_sim_set_temperature(&sim.devices[1], 22.0f);
+    CHECK(xQueueReceive(queue, &event, pdMS_TO_TICKS(PERIOD_MS * 2)));
+    CHECK(event.sample.value == 22.0f);
+
+    ds18b20_sampler_unsubscribe(sampler, &subscription);
+    ds18b20_sampler_delete(&sampler);
+    vQueueDelete(queue);
+    CHECK_EQ(1, host_task_count());
+}
+
+static void test_manager(void)
+{
+    _setup(false);
+    DS18B20_ManagerBusConfig bus = { .sampler = _config(), .queue_length = 8 };
+    DS18B20_Manager * manager = ds18b20_manager_create(&bus, 1);
+    CHECK(manager != NULL);
+    CHECK(ds18b20_manager_get_sampler(manager, 0) != NULL);
+
+    vTaskDelay(pdMS_TO_TICKS(PERIOD_MS * 2 + PERIOD_MS / 2));
+    DS18B20_SampleEvent event = {0};
+    size_t received = 0;
+    while (ds18b20_manager_receive(manager, 0, &event))
+    {
+        CHECK_EQ(DS18B20_OK, event.sample.error);
+        CHECK(event.sample.value == 20.0f + event.index);
+        ++received;
+    }
+    CHECK(received >= 2 * COUNT);
+    CHECK_EQ(0, ds18b20_manager_get_overflows(manager, 0));
+
+    ds18b20_manager_delete(&manager);
+    CHECK(manager == NULL);
+    CHECK_EQ(1, host_task_count());
+}
+
+int main(void)
+{
+    RUN_TEST(test_sampler_create_delete);
+    RUN_TEST(test_sampler_delete_with_pending_notification);
+    RUN_TEST(test_sampler_parasitic);
+    RUN_TEST(test_sampler_subscription);
+    RUN_TEST(test_manager);
+    return host_test_failures ? 1 : 0;
+}
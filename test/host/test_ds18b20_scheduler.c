@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file test_ds18b20_scheduler.c
+ * @brief Host tests of the multi-bus scheduler, against two simulated buses.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20.h"
+#include "ds18b20_scheduler.h"
+#include "ds18b20_sim.h"
+#include "host_test.h"
+
+int host_test_failures = 0;
+
+#define BUSES 2
+#define COUNT 3
+
+static DS18B20_SimBus sims[BUSES];
+static DS18B20_Info infos[BUSES][COUNT];
+static DS18B20_Info * devices[BUSES][COUNT];
+static DS18B20_Sample samples[BUSES][COUNT];
+
+static void _setup(DS18B20_SchedulerBus * buses)
+{
+    for (size_t b = 0; b < BUSES; ++b)
+    {
+        ds18b20_sim_init(&sims[b], false);
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            ds18b20_sim_add_device(&sims[b], b * COUNT + i + 1, 10.0f * b + i);
+            ds18b20_init(&infos[b][i], &sims[b].bus, sims[b].devices[i].rom_code);
+            ds18b20_use_crc(&infos[b][i], true);
+            devices[b][i] = &infos[b][i];
+        }
+        buses[b] = (DS18B20_SchedulerBus){ .bus = &sims[b].bus, .devices = devices[b], .count = COUNT, .samples = samples[b] };
+    }
+}
+
+static void test_scheduler_run_cycle(void)
+{
+    DS18B20_SchedulerBus buses[BUSES];
+    _setup(buses);
+    DS18B20_Scheduler scheduler;
+    CHECK_EQ(DS18B20_OK, ds18b20_scheduler_init(&scheduler, buses, BUSES));
+    for (size_t b = 0; b < BUSES; ++b)
+    {
+        CHECK(buses[b].values != NULL);
+        CHECK(buses[b].errs != NULL);
+    }
+
+    // a second cycle reuses the scratch storage of the first
+    for (int cycle = 0; cycle < 2; ++cycle)
+    {
+        CHECK_EQ(DS18B20_OK, ds18b20_scheduler_run_cycle(&scheduler));
+        for (size_t b = 0; b < BUSES; ++b)
+        {
+            for (size_t i = 0; i < COUNT; ++i)
+            {
+                DS18B20_Sample sample = {0};
+                CHECK_EQ(DS18B20_OK, ds18b20_scheduler_get_sample(&scheduler, b, i, &sample));
+                CHECK_EQ(DS18B20_OK, sample.error);
+                CHECK(sample.value == 10.0f * b + i);
+            }
+        }
+    }
+
+    // a failed device is reported in its own sample only
+    sims[1].devices[2].present = false;
+    CHECK(ds18b20_scheduler_run_cycle(&scheduler) != DS18B20_OK);
+    DS18B20_Sample sample = {0};
+    CHECK_EQ(DS18B20_OK, ds18b20_scheduler_get_sample(&scheduler, 1, 1, &sample));
+    CHECK_EQ(DS18B20_OK, sample.error);
+    CHECK_EQ(DS18B20_OK, ds18b20_scheduler_get_sample(&scheduler, 1, 2, &sample));
+    CHECK(sample.error != DS18B20_OK);
+
+    ds18b20_scheduler_deinit(&scheduler);
+    CHECK(buses[0].values == NULL);
+    CHECK(buses[1].errs == NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_scheduler_run_cycle);
+    return host_test_failures ? 1 : 0;
+}
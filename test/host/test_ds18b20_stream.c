@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file test_ds18b20_stream.c
+ * @brief Host tests of the delta-encoded sample stream.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ds18b20_stream.h"
+#include "host_test.h"
+
+int host_test_failures = 0;
+
+#define CHANNELS    3
+#define BLOCK_SIZE  64
+#define BLOCKS      8
+#define FRAMES      40
+
+static uint8_t storage[CHANNELS * 3 + BLOCK_SIZE * BLOCKS] __attribute__((aligned(2)));
+static int16_t input[FRAMES][CHANNELS];
+static int16_t output[FRAMES * CHANNELS];
+
+static size_t _drain(DS18B20_Stream * stream, size_t * blocks)
+{
+    // decode every closed block into output, in order
+    size_t frames = 0;
+    const uint8_t * block = NULL;
+    size_t size = 0;
+    *blocks = 0;
+    ds18b20_stream_flush(stream);
+    DS18B20_StreamHeader peeked;
+    while (ds18b20_stream_peek(stream, &block, &size, &peeked))
+    {
+        DS18B20_StreamHeader header;
+        CHECK_EQ(DS18B20_OK, ds18b20_stream_decode(block, size, &header, &output[frames * CHANNELS],
+                                                    (FRAMES - frames) * CHANNELS));
+        CHECK_EQ(frames, header.first_frame);
+        CHECK_EQ(CHANNELS, header.channels);
+        frames += header.frames;
+        ++*blocks;
+        CHECK_EQ(header.first_frame, peeked.first_frame);
+        CHECK(ds18b20_stream_consume(stream, peeked.first_frame));
+    }
+    return frames;
+}
+
+static void test_round_trip_mixed_resolution(void)
+{
+    DS18B20_Stream stream;
+    CHECK_EQ(CHANNELS * 3 + BLOCK_SIZE * BLOCKS, ds18b20_stream_storage_size(CHANNELS, BLOCK_SIZE, BLOCKS));
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_init(&stream, storage, CHANNELS, BLOCK_SIZE, BLOCKS));
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_set_resolution(&stream, 0, DS18B20_RESOLUTION_9_BIT));
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_set_resolution(&stream, 1, DS18B20_RESOLUTION_10_BIT));
+
+    // channels step by up to 2 LSBs of their resolution each frame
+    int16_t value[CHANNELS] = { 400, -200, 333 };
+    static const int step[CHANNELS] = { 8, 4, 1 };
+    for (size_t f = 0; f < FRAMES; ++f)
+    {
+        for (size_t i = 0; i < CHANNELS; ++i)
+        {
+            value[i] += step[i] * (int)((f * 7 + i * 3) % 5 - 2);
+            input[f][i] = value[i];
+        }
+        CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, value));
+    }
+
+    size_t blocks = 0;
+    CHECK_EQ(FRAMES, _drain(&stream, &blocks));
+    CHECK(memcmp(input, output, sizeof(input)) == 0);
+
+    // one nibble per reading, after the keyframe: 40 frames of 3 channels fit in two blocks
+    CHECK(blocks <= 2);
+}
+
+static void test_unaligned_readings_are_exact(void)
+{
+    // readings that do not match the channel resolution are escaped, not truncated
+    DS18B20_Stream stream;
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_init(&stream, storage, CHANNELS, BLOCK_SIZE, BLOCKS));
+    for (size_t i = 0; i < CHANNELS; ++i)
+    {
+        CHECK_EQ(DS18B20_OK, ds18b20_stream_set_resolution(&stream, i, DS18B20_RESOLUTION_9_BIT));
+    }
+    for (size_t f = 0; f < FRAMES; ++f)
+    {
+        for (size_t i = 0; i < CHANNELS; ++i)
+        {
+            input[f][i] = (int16_t)(100 + f * (i + 1) * 3);
+        }
+        CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, input[f]));
+    }
+
+    size_t blocks = 0;
+    CHECK_EQ(FRAMES, _drain(&stream, &blocks));
+    CHECK(memcmp(input, output, sizeof(input)) == 0);
+}
+
+static void test_resolution_change_closes_block(void)
+{
+    DS18B20_Stream stream;
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_init(&stream, storage, CHANNELS, BLOCK_SIZE, BLOCKS));
+    int16_t frame[CHANNELS] = { 16, 32, 48 };
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, frame));
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_set_resolution(&stream, 2, DS18B20_RESOLUTION_11_BIT));
+    CHECK_EQ(1, stream.used);
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, frame));
+
+    size_t blocks = 0;
+    CHECK_EQ(2, _drain(&stream, &blocks));
+    CHECK_EQ(2, blocks);
+    CHECK(memcmp(&output[CHANNELS], frame, sizeof(frame)) == 0);
+}
+
+static void test_overwrite_while_peeked(void)
+{
+    DS18B20_Stream stream;
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_init(&stream, storage, CHANNELS, BLOCK_SIZE, 2));
+    int16_t frame[CHANNELS] = { 16, 32, 48 };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, frame));
+        ds18b20_stream_flush(&stream);
+    }
+    CHECK_EQ(2, stream.used);
+
+    const uint8_t * block = NULL;
+    size_t size = 0;
+    DS18B20_StreamHeader peeked;
+    CHECK(ds18b20_stream_peek(&stream, &block, &size, &peeked));
+    CHECK_EQ(0, peeked.first_frame);
+
+    // the ring is full, so the next append overwrites the peeked block
+    CHECK_EQ(DS18B20_OK, ds18b20_stream_append(&stream, frame));
+    CHECK_EQ(1, stream.dropped);
+    CHECK(!ds18b20_stream_consume(&stream, peeked.first_frame));
+    CHECK_EQ(1, stream.used);
+
+    // the block that is now oldest is still released normally
+    DS18B20_StreamHeader next;
+    CHECK(ds18b20_stream_peek(&stream, &block, &size, &next));
+    CHECK_EQ(1, next.first_frame);
+    CHECK(ds18b20_stream_consume(&stream, next.first_frame));
+    CHECK_EQ(0, stream.used);
+}
+
+int main(void)
+{
+    RUN_TEST(test_round_trip_mixed_resolution);
+    RUN_TEST(test_unaligned_readings_are_exact);
+    RUN_TEST(test_resolution_change_closes_block);
+    RUN_TEST(test_overwrite_while_peeked);
+    return host_test_failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 David Antliff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file test_ds18b20_table.c
+ * @brief Host tests of saving and restoring device tables, against the simulated bus.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "ds18b20.h"
+#include "ds18b20_table.h"
+#include "ds18b20_sim.h"
+#include "host_test.h"
+
+int host_test_failures = 0;
+
+#define COUNT 3
+
+static DS18B20_SimBus sim;
+static DS18B20_Info saved[COUNT];
+static const DS18B20_Info * saved_devices[COUNT] = { &saved[0], &saved[1], &saved[2] };
+
+static void _setup(void)
+{
+    static const DS18B20_RESOLUTION resolutions[COUNT] = {
+        DS18B20_RESOLUTION_9_BIT, DS18B20_RESOLUTION_11_BIT, DS18B20_RESOLUTION_12_BIT,
+    };
+    ds18b20_sim_init(&sim, true);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ds18b20_sim_add_device(&sim, i + 1, 20.0f + i);
+        ds18b20_init(&saved[i], &sim.bus, sim.devices[i].rom_code);
+        ds18b20_use_crc(&saved[i], i != 1);
+        CHECK(ds18b20_set_resolution(&saved[i], resolutions[i]));
+    }
+    CHECK(ds18b20_set_alarm(&saved[2], 40, -5));
+}
+
+static void _check_restored(const DS18B20_Info * restored)
+{
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        CHECK(restored[i].init);
+        CHECK(memcmp(restored[i].rom_code.bytes, saved[i].rom_code.bytes, 8) == 0);
+        CHECK_EQ(saved[i].resolution, restored[i].resolution);
+        CHECK_EQ(saved[i].use_crc, restored[i].use_crc);
+        CHECK_EQ(saved[i].solo, restored[i].solo);
+        CHECK_EQ(saved[i].trigger_high, restored[i].trigger_high);
+        CHECK_EQ(saved[i].trigger_low, restored[i].trigger_low);
+        CHECK_EQ(saved[i].configuration, restored[i].configuration);
+        CHECK(restored[i].config_unverified);
+    }
+}
+
+static void test_round_trip(void)
+{
+    _setup();
+    uint8_t buffer[64];
+    size_t size = sizeof(buffer);
+    CHECK_EQ(DS18B20_OK, ds18b20_table_save(saved_devices, COUNT, true, buffer, &size));
+    CHECK_EQ(ds18b20_table_size(COUNT), size);
+
+    // restoring does not access the bus
+    DS18B20_Info restored[COUNT];
+    DS18B20_Info * devices[COUNT] = { &restored[0], &restored[1], &restored[2] };
+    size_t count = 0;
+    bool parasitic = false;
+    unsigned int resets = sim.resets;
+    int64_t before = esp_timer_get_time();
+    CHECK_EQ(DS18B20_OK, ds18b20_table_restore(devices, COUNT, &sim.bus, buffer, size, &count, &parasitic));
+    CHECK_EQ(before, esp_timer_get_time());
+    CHECK_EQ(resets, sim.resets);
+    CHECK_EQ(COUNT, count);
+    CHECK(parasitic);
+    _check_restored(restored);
+
+    // the restored devices read as before, and are verified by the read
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&restored[2]);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        float value = 0.0f;
+        CHECK_EQ(DS18B20_OK, ds18b20_read_temp(&restored[i], &value));
+        CHECK(value == 20.0f + i);
+        CHECK(restored[i].config_valid && !restored[i].config_unverified);
+        CHECK_EQ(saved[i].resolution, restored[i].resolution);
+    }
+}
+
+static void test_restore_then_configure(void)
+{
+    _setup();
+    uint8_t buffer[64];
+    size_t size = sizeof(buffer);
+    CHECK_EQ(DS18B20_OK, ds18b20_table_save(saved_devices, COUNT, true, buffer, &size));
+
+    // power cycled since the table was saved, so the devices are back at their EEPROM defaults
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ds18b20_sim_power_on_reset(&sim.devices[i]);
+        CHECK_EQ(12, ds18b20_sim_resolution(&sim.devices[i]));
+    }
+
+    DS18B20_Info restored[COUNT];
+    DS18B20_Info * devices[COUNT] = { &restored[0], &restored[1], &restored[2] };
+    size_t count = 0;
+    CHECK_EQ(DS18B20_OK, ds18b20_table_restore(devices, COUNT, &sim.bus, buffer, size, &count, NULL));
+
+    // the restored configuration matches the request, but the device does not, so it is written
+    CHECK(ds18b20_set_resolution(&restored[0], DS18B20_RESOLUTION_9_BIT));
+    CHECK_EQ(9, ds18b20_sim_resolution(&sim.devices[0]));
+    CHECK_EQ(DS18B20_RESOLUTION_9_BIT, restored[0].resolution);
+    CHECK(restored[0].config_valid && !restored[0].config_unverified);
+
+    CHECK(ds18b20_set_alarm(&restored[2], 40, -5));
+    CHECK_EQ(40, (int8_t)sim.devices[2].scratchpad[2]);
+    CHECK_EQ(-5, (int8_t)sim.devices[2].scratchpad[3]);
+    CHECK_EQ(DS18B20_RESOLUTION_12_BIT, restored[2].resolution);
+
+    // once confirmed, the same request does not access the bus
+    int64_t before = esp_timer_get_time();
+    CHECK(ds18b20_set_resolution(&restored[0], DS18B20_RESOLUTION_9_BIT));
+    CHECK_EQ(before, esp_timer_get_time());
+}
+
+static void test_restore_unknown_config(void)
+{
+    // a device whose configuration is unknown is saved without it, and adopts the device's on restore
+    ds18b20_sim_init(&sim, false);
+    ds18b20_sim_add_device(&sim, 1, 20.0f);
+    DS18B20_Info info;
+    ds18b20_init(&info, &sim.bus, sim.devices[0].rom_code);
+    info.config_valid = false;   // as after a failed configuration write
+    const DS18B20_Info * device = &info;
+    uint8_t buffer[32];
+    size_t size = sizeof(buffer);
+    CHECK_EQ(DS18B20_OK, ds18b20_table_save(&device, 1, false, buffer, &size));
+
+    DS18B20_Info restored;
+    DS18B20_Info * restored_device = &restored;
+    size_t count = 0;
+    CHECK_EQ(DS18B20_OK, ds18b20_table_restore(&restored_device, 1, &sim.bus, buffer, size, &count, NULL));
+    CHECK(!restored.config_valid);
+
+    ds18b20_convert_all(&sim.bus);
+    ds18b20_wait_for_conversion(&restored);
+    float value = 0.0f;
+    CHECK_EQ(DS18B20_OK, ds18b20_read_temp(&restored, &value));
+    CHECK(value == 20.0f);
+    CHECK(restored.config_valid && !restored.config_unverified);
+    CHECK_EQ(DS18B20_RESOLUTION_12_BIT, restored.resolution);
+}
+
+static void test_corrupt_table(void)
+{
+    _setup();
+    uint8_t buffer[64];
+    size_t size = sizeof(buffer);
+    CHECK_EQ(DS18B20_OK, ds18b20_table_save(saved_devices, COUNT, false, buffer, &size));
+
+    DS18B20_Info restored[COUNT];
+    DS18B20_Info * devices[COUNT] = { &restored[0], &restored[1], &restored[2] };
+    size_t count = COUNT;
+    CHECK_EQ(DS18B20_ERROR_UNKNOWN, ds18b20_table_restore(devices, COUNT - 1, &sim.bus, buffer, size, &count, NULL));
+    CHECK_EQ(0, count);
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_table_restore(devices, COUNT, &sim.bus, buffer, size - 1, &count, NULL));
+
+    buffer[12] ^= 0x01;
+    CHECK_EQ(DS18B20_ERROR_CRC, ds18b20_table_restore(devices, COUNT, &sim.bus, buffer, size, &count, NULL));
+    CHECK_EQ(0, count);
+
+    buffer[0] = 'X';
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_table_restore(devices, COUNT, &sim.bus, buffer, size, &count, NULL));
+}
+
+static void test_nvs_round_trip(void)
+{
+    _setup();
+    const nvs_handle_t handle = 1;
+    CHECK_EQ(DS18B20_OK, ds18b20_table_save_nvs(handle, "ds18b20", saved_devices, COUNT, false));
+
+    DS18B20_Info restored[COUNT];
+    DS18B20_Info * devices[COUNT] = { &restored[0], &restored[1], &restored[2] };
+    size_t count = 0;
+    bool parasitic = true;
+    CHECK_EQ(DS18B20_OK, ds18b20_table_restore_nvs(handle, "ds18b20", devices, COUNT, &sim.bus, &count, &parasitic));
+    CHECK_EQ(COUNT, count);
+    CHECK(!parasitic);
+    _check_restored(restored);
+
+    CHECK_EQ(DS18B20_ERROR_DEVICE, ds18b20_table_restore_nvs(handle, "missing", devices, COUNT, &sim.bus, &count, NULL));
+}
+
+int main(void)
+{
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_restore_then_configure);
+    RUN_TEST(test_restore_unknown_config);
+    RUN_TEST(test_corrupt_table);
+    RUN_TEST(test_nvs_round_trip);
+    return host_test_failures ? 1 : 0;
+}